@@ -0,0 +1,292 @@
+#include "bgzf.h"
+#include <cstring>
+#include <algorithm>
+#include <thread>
+#include <zlib.h>
+
+using namespace std;
+
+const size_t CABECERA_BGZF = 18;  // Cabecera gzip con el campo extra BC
+const size_t PIE_BGZF = 8;        // CRC32 y tamaño sin comprimir
+
+// Escribe un entero little-endian de 'bytes' bytes
+static void poner_le(uint8_t* destino, uint32_t valor, int bytes) {
+    for (int i = 0; i < bytes; i++) {
+        destino[i] = (uint8_t)(valor >> (8 * i));
+    }
+}
+
+// Comprime con deflate crudo (sin cabecera zlib); devuelve los bytes producidos o 0 si no cupo
+static size_t deflate_crudo(const uint8_t* datos, size_t n, uint8_t* salida, size_t capacidad, int nivel) {
+    z_stream flujo;
+    memset(&flujo, 0, sizeof(flujo));
+    if (deflateInit2(&flujo, nivel, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return 0;
+    }
+    flujo.next_in = const_cast<Bytef*>(datos);
+    flujo.avail_in = n;
+    flujo.next_out = salida;
+    flujo.avail_out = capacidad;
+    int estado = deflate(&flujo, Z_FINISH);
+    size_t producidos = capacidad - flujo.avail_out;
+    deflateEnd(&flujo);
+    return estado == Z_STREAM_END ? producidos : 0;
+}
+
+size_t comprimir_bloque_bgzf(const uint8_t* datos, size_t n, uint8_t* salida, int nivel) {
+    size_t capacidad = MAX_BLOQUE_BGZF - CABECERA_BGZF - PIE_BGZF;
+    uint8_t* cdata = salida + CABECERA_BGZF;
+
+    size_t comprimidos = deflate_crudo(datos, n, cdata, capacidad, nivel);
+    if (comprimidos == 0) {
+        // Datos incompresibles: nivel 0 (almacenado) siempre cabe con MAX_DATOS_BLOQUE_BGZF
+        comprimidos = deflate_crudo(datos, n, cdata, capacidad, 0);
+        if (comprimidos == 0) return 0;
+    }
+
+    size_t total = CABECERA_BGZF + comprimidos + PIE_BGZF;
+    const uint8_t cabecera[CABECERA_BGZF] = {
+        0x1f, 0x8b, 8, 4,   // gzip, deflate, FEXTRA
+        0, 0, 0, 0,         // MTIME
+        0, 0xff,            // XFL, OS desconocido
+        6, 0,               // XLEN
+        'B', 'C', 2, 0,     // Subcampo BC de 2 bytes
+        0, 0                // BSIZE (se completa abajo)
+    };
+    memcpy(salida, cabecera, CABECERA_BGZF);
+    poner_le(salida + 16, total - 1, 2);
+
+    uint32_t crc = crc32(crc32(0L, Z_NULL, 0), datos, n);
+    poner_le(salida + CABECERA_BGZF + comprimidos, crc, 4);
+    poner_le(salida + CABECERA_BGZF + comprimidos + 4, n, 4);
+    return total;
+}
+
+EscritorBgzf::EscritorBgzf(EscritorBinario& destino, int nivel) : destino(destino), nivel(nivel), error(false) {
+    num_hilos = thread::hardware_concurrency();
+    if (num_hilos < 1) num_hilos = 1;
+    capacidad_tanda = MAX_DATOS_BLOQUE_BGZF * BLOQUES_POR_HILO_BGZF * num_hilos;
+    tanda.reserve(capacidad_tanda);
+}
+
+void EscritorBgzf::escribir_bytes(const void* datos, size_t n) {
+    const uint8_t* origen = static_cast<const uint8_t*>(datos);
+    while (n > 0) {
+        size_t bloque = capacidad_tanda - tanda.size();
+        if (bloque > n) bloque = n;
+        tanda.insert(tanda.end(), origen, origen + bloque);
+        origen += bloque;
+        n -= bloque;
+        if (tanda.size() == capacidad_tanda) {
+            comprimir_tanda();
+        }
+    }
+}
+
+void EscritorBgzf::escribir_u8(uint8_t valor) {
+    tanda.push_back(valor);
+    if (tanda.size() == capacidad_tanda) {
+        comprimir_tanda();
+    }
+}
+
+// Comprime cada bloque de la tanda en paralelo (el hilo t toma los bloques t, t + num_hilos, ...)
+// y luego los escribe en el orden original
+void EscritorBgzf::comprimir_tanda() {
+    if (tanda.empty()) return;
+
+    size_t num_bloques = (tanda.size() + MAX_DATOS_BLOQUE_BGZF - 1) / MAX_DATOS_BLOQUE_BGZF;
+    if (comprimidos.size() < num_bloques * MAX_BLOQUE_BGZF) comprimidos.resize(num_bloques * MAX_BLOQUE_BGZF);
+    tamanos.assign(num_bloques, 0);
+
+    auto trabajar = [&](int hilo) {
+        for (size_t b = hilo; b < num_bloques; b += num_hilos) {
+            size_t inicio = b * MAX_DATOS_BLOQUE_BGZF;
+            size_t n = min(MAX_DATOS_BLOQUE_BGZF, tanda.size() - inicio);
+            tamanos[b] = comprimir_bloque_bgzf(&tanda[inicio], n, &comprimidos[b * MAX_BLOQUE_BGZF], nivel);
+        }
+    };
+
+    vector<thread> hilos;
+    int usados = min((size_t)num_hilos, num_bloques);
+    for (int t = 1; t < usados; t++) {
+        hilos.push_back(thread(trabajar, t));
+    }
+    trabajar(0);
+    for (size_t t = 0; t < hilos.size(); t++) {
+        hilos[t].join();
+    }
+
+    for (size_t b = 0; b < num_bloques; b++) {
+        if (tamanos[b] == 0) error = true;
+        destino.escribir_bytes(&comprimidos[b * MAX_BLOQUE_BGZF], tamanos[b]);
+    }
+    tanda.clear();
+}
+
+bool EscritorBgzf::terminar() {
+    comprimir_tanda();
+
+    // Bloque vacio que marca el fin de un archivo BGZF
+    uint8_t fin[MAX_BLOQUE_BGZF];
+    size_t n = comprimir_bloque_bgzf(nullptr, 0, fin, nivel);
+    if (n == 0) return false;
+    destino.escribir_bytes(fin, n);
+    return !error;
+}
+
+size_t MemoriaBgzf::bytes_reservados() const {
+    return comprimidos.capacity() + descomprimidos.capacity() + tam_comprimido.capacity() * sizeof(size_t) +
+           tam_datos.capacity() * sizeof(size_t) + correcto.capacity();
+}
+
+// Los primeros bytes de un archivo gzip son 1f 8b
+bool es_gzip(LectorBinario& entrada) {
+    return entrada.disponibles(2) >= 2 && entrada.actual()[0] == 0x1f && entrada.actual()[1] == 0x8b;
+}
+
+// Un bloque BGZF es un miembro gzip con FEXTRA cuyo primer subcampo es BC
+bool es_bgzf(LectorBinario& entrada) {
+    if (!es_gzip(entrada) || entrada.disponibles(CABECERA_BGZF) < CABECERA_BGZF) return false;
+    const uint8_t* c = entrada.actual();
+    return (c[3] & 4) && c[10] == 6 && c[11] == 0 && c[12] == 'B' && c[13] == 'C';
+}
+
+// Descompresion secuencial de un gzip comun (posiblemente de varios miembros concatenados)
+static bool descomprimir_secuencial(LectorBinario& entrada, const ConsumidorDatos& consumir) {
+    z_stream flujo;
+    memset(&flujo, 0, sizeof(flujo));
+    if (inflateInit2(&flujo, 15 + 16) != Z_OK) return false;
+
+    vector<uint8_t> salida(TAM_BUFFER_BINARIO);
+    bool correcto = true;
+    bool fin_miembro = false;
+
+    while (true) {
+        size_t n = entrada.disponibles();
+        if (n == 0) {
+            correcto = fin_miembro; // El archivo no puede terminar a mitad de un miembro
+            break;
+        }
+        flujo.next_in = const_cast<Bytef*>(entrada.actual());
+        flujo.avail_in = n;
+
+        // Seguir mientras quede entrada o zlib haya llenado la salida (puede tener datos pendientes)
+        do {
+            if (fin_miembro) {
+                if (flujo.avail_in == 0) break;
+                inflateReset(&flujo); // Otro miembro gzip concatenado a continuacion
+                fin_miembro = false;
+            }
+            flujo.next_out = salida.data();
+            flujo.avail_out = salida.size();
+            int estado = inflate(&flujo, Z_NO_FLUSH);
+            if (estado != Z_OK && estado != Z_STREAM_END && estado != Z_BUF_ERROR) {
+                correcto = false;
+                break;
+            }
+            size_t producidos = salida.size() - flujo.avail_out;
+            if (estado == Z_BUF_ERROR && producidos == 0) {
+                break; // Sin avance posible: hace falta mas entrada
+            }
+            consumir(salida.data(), producidos);
+            if (estado == Z_STREAM_END) {
+                fin_miembro = true;
+            }
+        } while (flujo.avail_in > 0 || flujo.avail_out == 0);
+        if (!correcto) break;
+        entrada.avanzar(n - flujo.avail_in);
+    }
+
+    inflateEnd(&flujo);
+    return correcto;
+}
+
+// Descomprime un bloque BGZF completo (cabecera incluida) y verifica su CRC32
+static bool descomprimir_bloque_bgzf(const uint8_t* bloque, size_t tam, uint8_t* salida, size_t& producidos) {
+    size_t xlen = bloque[10] | (bloque[11] << 8);
+    size_t inicio = 12 + xlen;
+    if (tam < inicio + PIE_BGZF) return false;
+
+    const uint8_t* pie = bloque + tam - PIE_BGZF;
+    uint32_t crc_esperado = pie[0] | (pie[1] << 8) | (pie[2] << 16) | ((uint32_t)pie[3] << 24);
+    size_t isize = pie[4] | (pie[5] << 8) | (pie[6] << 16) | ((uint32_t)pie[7] << 24);
+    if (isize > MAX_BLOQUE_BGZF) return false;
+
+    z_stream flujo;
+    memset(&flujo, 0, sizeof(flujo));
+    if (inflateInit2(&flujo, -15) != Z_OK) return false;
+    flujo.next_in = const_cast<Bytef*>(bloque + inicio);
+    flujo.avail_in = tam - inicio - PIE_BGZF;
+    flujo.next_out = salida;
+    flujo.avail_out = MAX_BLOQUE_BGZF;
+    int estado = inflate(&flujo, Z_FINISH);
+    producidos = MAX_BLOQUE_BGZF - flujo.avail_out;
+    inflateEnd(&flujo);
+
+    return estado == Z_STREAM_END && producidos == isize &&
+           crc32(crc32(0L, Z_NULL, 0), salida, producidos) == crc_esperado;
+}
+
+// Descompresion paralela de BGZF: se leen las cabeceras de una tanda de bloques, cada hilo
+// descomprime los bloques que le tocan y los datos se entregan al consumidor en orden
+static bool descomprimir_bgzf(LectorBinario& entrada, const ConsumidorDatos& consumir, MemoriaBgzf& memoria) {
+    int num_hilos = thread::hardware_concurrency();
+    if (num_hilos < 1) num_hilos = 1;
+    size_t max_bloques = BLOQUES_POR_HILO_BGZF * num_hilos;
+
+    // Los bloques se escriben antes de leerse, asi que basta con que tengan el tamaño (sin rellenar)
+    vector<uint8_t>& comprimidos = memoria.comprimidos;
+    vector<uint8_t>& descomprimidos = memoria.descomprimidos;
+    vector<size_t>& tam_comprimido = memoria.tam_comprimido;
+    vector<size_t>& tam_datos = memoria.tam_datos;
+    vector<char>& correcto = memoria.correcto;
+    if (comprimidos.size() < max_bloques * MAX_BLOQUE_BGZF) comprimidos.resize(max_bloques * MAX_BLOQUE_BGZF);
+    if (descomprimidos.size() < max_bloques * MAX_BLOQUE_BGZF) descomprimidos.resize(max_bloques * MAX_BLOQUE_BGZF);
+    if (tam_comprimido.size() < max_bloques) tam_comprimido.resize(max_bloques);
+    if (tam_datos.size() < max_bloques) tam_datos.resize(max_bloques);
+    if (correcto.size() < max_bloques) correcto.resize(max_bloques);
+
+    while (entrada.disponibles() > 0) {
+        // Leer la siguiente tanda de bloques completos
+        size_t num_bloques = 0;
+        while (num_bloques < max_bloques && entrada.disponibles() > 0) {
+            uint8_t* bloque = &comprimidos[num_bloques * MAX_BLOQUE_BGZF];
+            if (!es_bgzf(entrada) || !entrada.leer_bytes(bloque, CABECERA_BGZF)) return false;
+            size_t tam = (bloque[16] | (bloque[17] << 8)) + 1;
+            if (tam < CABECERA_BGZF + PIE_BGZF || !entrada.leer_bytes(bloque + CABECERA_BGZF, tam - CABECERA_BGZF)) {
+                return false;
+            }
+            tam_comprimido[num_bloques++] = tam;
+        }
+
+        auto trabajar = [&](int hilo) {
+            for (size_t b = hilo; b < num_bloques; b += num_hilos) {
+                correcto[b] = descomprimir_bloque_bgzf(&comprimidos[b * MAX_BLOQUE_BGZF], tam_comprimido[b],
+                                                       &descomprimidos[b * MAX_BLOQUE_BGZF], tam_datos[b]);
+            }
+        };
+        vector<thread> hilos;
+        int usados = min((size_t)num_hilos, num_bloques);
+        for (int t = 1; t < usados; t++) {
+            hilos.push_back(thread(trabajar, t));
+        }
+        trabajar(0);
+        for (size_t t = 0; t < hilos.size(); t++) {
+            hilos[t].join();
+        }
+
+        for (size_t b = 0; b < num_bloques; b++) {
+            if (!correcto[b]) return false;
+            consumir(&descomprimidos[b * MAX_BLOQUE_BGZF], tam_datos[b]);
+        }
+    }
+    return true;
+}
+
+bool descomprimir_gzip(LectorBinario& entrada, const ConsumidorDatos& consumir, MemoriaBgzf& memoria) {
+    if (es_bgzf(entrada)) {
+        return descomprimir_bgzf(entrada, consumir, memoria);
+    }
+    return descomprimir_secuencial(entrada, consumir);
+}
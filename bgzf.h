@@ -0,0 +1,65 @@
+#ifndef BGZF_H
+#define BGZF_H
+
+#include "binario.h"
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <functional>
+
+using namespace std;
+
+// BGZF: gzip partido en bloques independientes de hasta 64 KiB (formato de samtools/htslib).
+// Cualquier lector gzip lo descomprime, y los bloques se pueden comprimir en paralelo
+const size_t MAX_DATOS_BLOQUE_BGZF = 0xff00;  // Datos sin comprimir por bloque (igual que bgzip)
+const size_t MAX_BLOQUE_BGZF = 1 << 16;       // Tamaño maximo de un bloque comprimido
+const int BLOQUES_POR_HILO_BGZF = 16;         // Bloques que comprime cada hilo por tanda
+
+// Escritor BGZF: acumula datos en una tanda de bloques, los comprime en paralelo
+// y los escribe en orden a traves de un EscritorBinario
+class EscritorBgzf {
+public:
+    EscritorBgzf(EscritorBinario& destino, int nivel = 6);
+
+    void escribir_bytes(const void* datos, size_t n);
+    void escribir_u8(uint8_t valor);
+    bool terminar();              // Comprime lo pendiente y agrega el bloque vacio de fin de archivo
+
+private:
+    EscritorBinario& destino;
+    int nivel;
+    int num_hilos;
+    vector<uint8_t> tanda;        // Datos sin comprimir de la tanda actual
+    vector<uint8_t> comprimidos;  // Bloques comprimidos de la tanda; se reutilizan en las siguientes
+    vector<size_t> tamanos;
+    size_t capacidad_tanda;
+    bool error;
+
+    void comprimir_tanda();
+};
+
+// Recibe, en orden, cada tramo de datos ya descomprimido
+typedef function<void(const uint8_t* datos, size_t n)> ConsumidorDatos;
+
+// Comprime un bloque de datos en formato BGZF; devuelve el tamaño del bloque o 0 si falla
+size_t comprimir_bloque_bgzf(const uint8_t* datos, size_t n, uint8_t* salida, int nivel);
+
+// Buffers de la descompresion BGZF: una tanda de bloques comprimidos y sus datos. Viven en la
+// memoria de la sesion, asi que las tandas y las cargas siguientes no vuelven a reservarlos
+struct MemoriaBgzf {
+    vector<uint8_t> comprimidos;
+    vector<uint8_t> descomprimidos;
+    vector<size_t> tam_comprimido;
+    vector<size_t> tam_datos;
+    vector<char> correcto;
+
+    size_t bytes_reservados() const;
+};
+
+// Lectura de archivos comprimidos. Los BGZF se descomprimen por tandas de bloques en paralelo;
+// un gzip comun solo admite descompresion secuencial
+bool es_gzip(LectorBinario& entrada);
+bool es_bgzf(LectorBinario& entrada);
+bool descomprimir_gzip(LectorBinario& entrada, const ConsumidorDatos& consumir, MemoriaBgzf& memoria);
+
+#endif
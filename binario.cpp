@@ -0,0 +1,270 @@
+#include "binario.h"
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+// Reserva un buffer alineado a pagina
+static uint8_t* reservar_alineado(size_t tam) {
+    void* memoria = nullptr;
+    if (posix_memalign(&memoria, ALINEACION_BUFFER, tam) != 0) {
+        return nullptr;
+    }
+    return static_cast<uint8_t*>(memoria);
+}
+
+// ---------------------------------------------------------------------------
+// EscritorBinario
+// ---------------------------------------------------------------------------
+
+EscritorBinario::EscritorBinario() : fd(-1), buffer(nullptr), usados(0), total(0), error(false) {}
+
+EscritorBinario::~EscritorBinario() {
+    cerrar();
+    free(buffer);
+}
+
+bool EscritorBinario::abrir(const string& nombreArchivo) {
+    cerrar();
+    if (buffer == nullptr) {
+        buffer = reservar_alineado(TAM_BUFFER_BINARIO);
+        if (buffer == nullptr) return false;
+    }
+    fd = open(nombreArchivo.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    usados = 0;
+    total = 0;
+    error = (fd < 0);
+    return !error;
+}
+
+// Para retomar un archivo escrito a medias: descarta lo que haya despues de 'conservar' bytes
+// (por ejemplo un registro incompleto) y agrega a continuacion
+bool EscritorBinario::abrir_al_final(const string& nombreArchivo, uint64_t conservar) {
+    cerrar();
+    if (buffer == nullptr) {
+        buffer = reservar_alineado(TAM_BUFFER_BINARIO);
+        if (buffer == nullptr) return false;
+    }
+    fd = open(nombreArchivo.c_str(), O_WRONLY | O_CREAT, 0644);
+    usados = 0;
+    total = conservar;
+    error = (fd < 0 || ftruncate(fd, conservar) != 0 || lseek(fd, conservar, SEEK_SET) < 0);
+    return !error;
+}
+
+// Escribe el contenido del buffer al archivo, reintentando escrituras parciales
+void EscritorBinario::vaciar() {
+    size_t hecho = 0;
+    while (hecho < usados && !error) {
+        ssize_t n = write(fd, buffer + hecho, usados - hecho);
+        if (n <= 0) {
+            error = true;
+        } else {
+            hecho += n;
+        }
+    }
+    usados = 0;
+}
+
+bool EscritorBinario::sincronizar() {
+    if (fd < 0) return !error;
+    vaciar();
+    if (fdatasync(fd) != 0) error = true;
+    return !error;
+}
+
+bool EscritorBinario::cerrar() {
+    if (fd < 0) return !error;
+    vaciar();
+    if (close(fd) != 0) error = true;
+    fd = -1;
+    return !error;
+}
+
+void EscritorBinario::escribir_u8(uint8_t valor) {
+    if (usados == TAM_BUFFER_BINARIO) vaciar();
+    buffer[usados++] = valor;
+    total++;
+}
+
+void EscritorBinario::escribir_u16(uint16_t valor) {
+    uint8_t bytes[2] = {(uint8_t)valor, (uint8_t)(valor >> 8)};
+    escribir_bytes(bytes, 2);
+}
+
+void EscritorBinario::escribir_u32(uint32_t valor) {
+    uint8_t bytes[4];
+    for (int i = 0; i < 4; i++) bytes[i] = (uint8_t)(valor >> (8 * i));
+    escribir_bytes(bytes, 4);
+}
+
+void EscritorBinario::escribir_u64(uint64_t valor) {
+    uint8_t bytes[8];
+    for (int i = 0; i < 8; i++) bytes[i] = (uint8_t)(valor >> (8 * i));
+    escribir_bytes(bytes, 8);
+}
+
+void EscritorBinario::escribir_bytes(const void* datos, size_t n) {
+    const uint8_t* origen = static_cast<const uint8_t*>(datos);
+    total += n;
+    while (n > 0) {
+        if (usados == TAM_BUFFER_BINARIO) vaciar();
+        size_t bloque = TAM_BUFFER_BINARIO - usados;
+        if (bloque > n) bloque = n;
+        memcpy(buffer + usados, origen, bloque);
+        usados += bloque;
+        origen += bloque;
+        n -= bloque;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// LectorBinario
+// ---------------------------------------------------------------------------
+
+LectorBinario::LectorBinario()
+    : fd(-1), proyectado(false), datos(nullptr), buffer(nullptr), tam_datos(0), posicion(0),
+      tam_archivo(0), inicio_datos(0) {}
+
+LectorBinario::~LectorBinario() {
+    cerrar();
+    free(buffer);
+}
+
+bool LectorBinario::abrir(const string& nombreArchivo) {
+    cerrar();
+    fd = open(nombreArchivo.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        cerrar();
+        return false;
+    }
+    tam_archivo = S_ISREG(info.st_mode) ? info.st_size : ~0ULL; // En tuberias el tamaño no se conoce
+    if (S_ISREG(info.st_mode) && info.st_size > 0) {
+        void* mapa = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapa != MAP_FAILED) {
+            madvise(mapa, info.st_size, MADV_SEQUENTIAL);
+            proyectado = true;
+            datos = static_cast<const uint8_t*>(mapa);
+            tam_datos = info.st_size;
+            return true;
+        }
+    }
+
+    // Sin mmap: lectura secuencial en bloques
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    if (buffer == nullptr) {
+        buffer = reservar_alineado(TAM_BUFFER_BINARIO);
+        if (buffer == nullptr) {
+            cerrar();
+            return false;
+        }
+    }
+    datos = buffer;
+    return true;
+}
+
+void LectorBinario::cerrar() {
+    if (proyectado) {
+        munmap(const_cast<uint8_t*>(datos), tam_datos);
+        proyectado = false;
+    }
+    if (fd >= 0) {
+        close(fd);
+        fd = -1;
+    }
+    datos = nullptr;
+    tam_datos = 0;
+    posicion = 0;
+    tam_archivo = 0;
+    inicio_datos = 0;
+}
+
+bool LectorBinario::rellenar(size_t minimo) {
+    if (tam_datos - posicion >= minimo) return true;
+    if (proyectado || fd < 0 || minimo > TAM_BUFFER_BINARIO) return false;
+
+    // Mover los bytes pendientes al inicio y completar el buffer desde el archivo
+    size_t pendientes = tam_datos - posicion;
+    memmove(buffer, buffer + posicion, pendientes);
+    inicio_datos += posicion;
+    tam_datos = pendientes;
+    posicion = 0;
+    while (tam_datos < minimo) {
+        ssize_t n = read(fd, buffer + tam_datos, TAM_BUFFER_BINARIO - tam_datos);
+        if (n <= 0) return false;
+        tam_datos += n;
+    }
+    return true;
+}
+
+size_t LectorBinario::disponibles() {
+    if (posicion == tam_datos && !rellenar(1)) return 0;
+    return tam_datos - posicion;
+}
+
+// En una tuberia cada read puede traer pocos bytes: se sigue leyendo hasta tener 'minimo' o llegar al final
+size_t LectorBinario::disponibles(size_t minimo) {
+    rellenar(minimo);
+    return tam_datos - posicion;
+}
+
+bool LectorBinario::leer_u8(uint8_t& valor) {
+    if (!rellenar(1)) return false;
+    valor = datos[posicion++];
+    return true;
+}
+
+bool LectorBinario::leer_u16(uint16_t& valor) {
+    if (!rellenar(2)) return false;
+    valor = (uint16_t)(datos[posicion] | (datos[posicion + 1] << 8));
+    posicion += 2;
+    return true;
+}
+
+bool LectorBinario::leer_u32(uint32_t& valor) {
+    if (!rellenar(4)) return false;
+    valor = 0;
+    for (int i = 3; i >= 0; i--) valor = (valor << 8) | datos[posicion + i];
+    posicion += 4;
+    return true;
+}
+
+bool LectorBinario::leer_u64(uint64_t& valor) {
+    if (!rellenar(8)) return false;
+    valor = 0;
+    for (int i = 7; i >= 0; i--) valor = (valor << 8) | datos[posicion + i];
+    posicion += 8;
+    return true;
+}
+
+bool LectorBinario::leer_bytes(void* destino, size_t n) {
+    uint8_t* salida = static_cast<uint8_t*>(destino);
+    while (n > 0) {
+        size_t hay = disponibles();
+        if (hay == 0) return false;
+        size_t bloque = hay < n ? hay : n;
+        memcpy(salida, datos + posicion, bloque);
+        posicion += bloque;
+        salida += bloque;
+        n -= bloque;
+    }
+    return true;
+}
+
+bool LectorBinario::saltar(uint64_t n) {
+    while (n > 0) {
+        size_t hay = disponibles();
+        if (hay == 0) return false;
+        size_t bloque = hay < n ? hay : n;
+        posicion += bloque;
+        n -= bloque;
+    }
+    return true;
+}
@@ -0,0 +1,89 @@
+#ifndef BINARIO_H
+#define BINARIO_H
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+using namespace std;
+
+const size_t TAM_BUFFER_BINARIO = 1 << 20; // 1 MiB por llamada al sistema
+const size_t ALINEACION_BUFFER = 4096;     // Alineado a pagina para que el kernel copie bloques completos
+
+// Escritor binario con buffer propio. Los enteros se escriben siempre en little-endian,
+// sin importar la arquitectura, y el disco solo se toca cuando el buffer se llena
+class EscritorBinario {
+public:
+    EscritorBinario();
+    ~EscritorBinario();
+    EscritorBinario(const EscritorBinario&) = delete; // Una copia cerraria el mismo descriptor dos veces
+    EscritorBinario& operator=(const EscritorBinario&) = delete;
+
+    bool abrir(const string& nombreArchivo);
+    bool abrir_al_final(const string& nombreArchivo, uint64_t conservar); // Conserva los primeros bytes y sigue desde ahi
+    bool cerrar();               // Vacia el buffer y cierra; devuelve false si hubo algun error de escritura
+    bool sincronizar();          // Vacia el buffer y espera a que los datos lleguen al disco (punto de control)
+
+    void escribir_u8(uint8_t valor);
+    void escribir_u16(uint16_t valor);
+    void escribir_u32(uint32_t valor);
+    void escribir_u64(uint64_t valor);
+    void escribir_bytes(const void* datos, size_t n);
+
+    uint64_t escritos() const { return total; }
+
+private:
+    int fd;
+    uint8_t* buffer;
+    size_t usados;
+    uint64_t total;
+    bool error;
+
+    void vaciar();
+};
+
+// Lector binario. Intenta proyectar el archivo completo en memoria (mmap); si no puede,
+// lee en bloques grandes. Toda lectura verifica que queden bytes suficientes
+class LectorBinario {
+public:
+    LectorBinario();
+    ~LectorBinario();
+    LectorBinario(const LectorBinario&) = delete; // Una copia liberaria la proyeccion o el buffer dos veces
+    LectorBinario& operator=(const LectorBinario&) = delete;
+
+    bool abrir(const string& nombreArchivo);
+    void cerrar();
+
+    bool leer_u8(uint8_t& valor);
+    bool leer_u16(uint16_t& valor);
+    bool leer_u32(uint32_t& valor);
+    bool leer_u64(uint64_t& valor);
+    bool leer_bytes(void* destino, size_t n);
+    bool saltar(uint64_t n);
+    uint64_t restantes() const { return tam_archivo - (inicio_datos + posicion); } // Bytes sin leer (cota superior si no es un archivo regular)
+
+    // Acceso directo a los bytes pendientes: disponibles() garantiza al menos un byte
+    // contiguo si el archivo no se ha terminado (0 al final), actual() apunta al primero
+    // y avanzar() consume los que ya se procesaron
+    size_t disponibles();
+    size_t disponibles(size_t minimo); // Igual, pero antes reune al menos 'minimo' bytes si el archivo los tiene
+    const uint8_t* actual() const { return datos + posicion; }
+    void avanzar(size_t n) { posicion += n; }
+
+    // Con el archivo proyectado los punteros de actual() siguen validos hasta cerrar()
+    bool en_memoria() const { return proyectado; }
+
+private:
+    int fd;
+    bool proyectado;             // true si datos apunta al archivo proyectado con mmap
+    const uint8_t* datos;        // Archivo proyectado o buffer propio
+    uint8_t* buffer;
+    size_t tam_datos;            // Bytes validos en datos
+    size_t posicion;             // Siguiente byte por leer dentro de datos
+    uint64_t tam_archivo;
+    uint64_t inicio_datos;       // Desplazamiento en el archivo del primer byte de datos
+
+    bool rellenar(size_t minimo); // Asegura al menos 'minimo' bytes contiguos pendientes
+};
+
+#endif
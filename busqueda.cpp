@@ -0,0 +1,149 @@
+#include "busqueda.h"
+#include "iupac.h"
+#include "perfil.h"
+#include <cstring>
+#include <algorithm>
+
+uint8_t resumen_alfabeto(const char* texto, size_t n) {
+    uint8_t clases = 0;
+    for (size_t i = 0; i < n; i++) {
+        clases |= TABLA_CLASES[(unsigned char)texto[i]];
+    }
+    return clases;
+}
+
+// Codigo de 2 bits de A, C, G, T; solo se usa cuando el texto no tiene otros simbolos
+constexpr uint8_t iupac_dos_bits(int c) {
+    return c == 'C' ? 1 : c == 'G' ? 2 : c == 'T' ? 3 : 0;
+}
+constexpr TablaIupac TABLA_DOS_BITS = tabla_iupac<iupac_dos_bits>();
+
+Buscador::Buscador(const string& patron, uint8_t alfabeto_texto) : texto_patron(patron), prefijo(0) {
+    uint8_t alfabeto_patron = resumen_alfabeto(patron.data(), patron.size());
+
+    if ((alfabeto_patron & ~CLASE_ACGT) == 0 && (alfabeto_texto & ~CLASE_ACGT) == 0) {
+        variante = BUSCADOR_EXACTO;
+    } else if (patron.size() <= (size_t)MAX_PATRON_REGISTRO) {
+        variante = BUSCADOR_REGISTRO;
+    } else if ((alfabeto_patron & ~(CLASE_ACGT | CLASE_U)) == 0) {
+        variante = BUSCADOR_LITERAL;
+    } else {
+        variante = BUSCADOR_GENERAL;
+    }
+
+    if (variante == BUSCADOR_EXACTO) {
+        size_t largo = min(patron.size(), (size_t)MAX_PREFIJO_EXACTO);
+        for (size_t k = 0; k < largo; k++) {
+            prefijo = (prefijo << 2) | TABLA_DOS_BITS[(unsigned char)patron[k]];
+        }
+    }
+
+    if (variante == BUSCADOR_REGISTRO) {
+        for (int c = 0; c < 256; c++) {
+            uint64_t mascara = 0;
+            for (size_t k = 0; k < patron.size(); k++) {
+                if (iupac_compatibles(c, patron[k])) {
+                    mascara |= 1ULL << k;
+                }
+            }
+            mascaras_registro[c] = mascara;
+        }
+    }
+}
+
+// Cada variante es una especializacion; el despacho ocurre una vez por llamada y no por caracter
+template <TipoBuscador T>
+size_t buscar_desde(const Buscador& b, const char* texto, size_t n, size_t desde);
+
+// Ventana deslizante de 2 bits por base sobre el prefijo del patron; el resto se compara con memcmp
+template <>
+size_t buscar_desde<BUSCADOR_EXACTO>(const Buscador& b, const char* texto, size_t n, size_t desde) {
+    const string& patron = b.patron();
+    size_t m = patron.size();
+    size_t largo = min(m, (size_t)MAX_PREFIJO_EXACTO);
+    uint64_t mascara = largo == 32 ? ~0ULL : (1ULL << (2 * largo)) - 1;
+    uint64_t objetivo = b.codigo_prefijo();
+
+    uint64_t ventana = 0;
+    for (size_t i = desde; i + (m - largo) < n; i++) {
+        ventana = ((ventana << 2) | TABLA_DOS_BITS[(unsigned char)texto[i]]) & mascara;
+        if (i + 1 - desde < largo || ventana != objetivo) continue;
+        size_t pos = i + 1 - largo;
+        if (memcmp(texto + pos + largo, patron.data() + largo, m - largo) == 0) {
+            return pos;
+        }
+    }
+    return string::npos;
+}
+
+// Shift-And: el bit k del estado indica que los k+1 caracteres anteriores coinciden con el inicio del patron
+template <>
+size_t buscar_desde<BUSCADOR_REGISTRO>(const Buscador& b, const char* texto, size_t n, size_t desde) {
+    const uint64_t* mascaras = b.mascaras();
+    size_t m = b.patron().size();
+    uint64_t final = 1ULL << (m - 1);
+
+    uint64_t estado = 0;
+    for (size_t i = desde; i < n; i++) {
+        estado = ((estado << 1) | 1) & mascaras[(unsigned char)texto[i]];
+        if (estado & final) {
+            return i + 1 - m;
+        }
+    }
+    return string::npos;
+}
+
+// Comparacion posicion por posicion; sin X, '-' ni codigos ambiguos en el patron la igualdad
+// ya esta contenida en la tabla de aceptados y basta una consulta por caracter
+template <bool SOLO_LITERALES>
+static size_t buscar_por_posicion(const Buscador& b, const char* texto, size_t n, size_t desde) {
+    const string& patron = b.patron();
+    size_t m = patron.size();
+    uint64_t descartadas = 0; // Solo para el perfil
+    for (size_t j = desde; j + m <= n; j++) {
+        size_t k = 0;
+        if (SOLO_LITERALES) {
+            while (k < m && (TABLA_ACEPTADOS[(unsigned char)texto[j + k]] &
+                             TABLA_LITERALES[(unsigned char)patron[k]]) != 0) {
+                k++;
+            }
+        } else {
+            while (k < m && iupac_compatibles(texto[j + k], patron[k])) {
+                k++;
+            }
+        }
+        if (k == m) {
+            PERFIL_SUMAR(SALIDAS_TEMPRANAS, descartadas);
+            return j;
+        }
+        descartadas++; // La comparacion se corto en el primer caracter incompatible
+    }
+    PERFIL_SUMAR(SALIDAS_TEMPRANAS, descartadas);
+    return string::npos;
+}
+
+template <>
+size_t buscar_desde<BUSCADOR_LITERAL>(const Buscador& b, const char* texto, size_t n, size_t desde) {
+    return buscar_por_posicion<true>(b, texto, n, desde);
+}
+
+template <>
+size_t buscar_desde<BUSCADOR_GENERAL>(const Buscador& b, const char* texto, size_t n, size_t desde) {
+    return buscar_por_posicion<false>(b, texto, n, desde);
+}
+
+size_t Buscador::siguiente(const string& texto, size_t desde) const {
+    if (texto_patron.empty() || desde >= texto.size() || texto.size() - desde < texto_patron.size()) {
+        return string::npos;
+    }
+    size_t pos;
+    switch (variante) {
+        case BUSCADOR_EXACTO:   pos = buscar_desde<BUSCADOR_EXACTO>(*this, texto.data(), texto.size(), desde); break;
+        case BUSCADOR_REGISTRO: pos = buscar_desde<BUSCADOR_REGISTRO>(*this, texto.data(), texto.size(), desde); break;
+        case BUSCADOR_LITERAL:  pos = buscar_desde<BUSCADOR_LITERAL>(*this, texto.data(), texto.size(), desde); break;
+        default:                pos = buscar_desde<BUSCADOR_GENERAL>(*this, texto.data(), texto.size(), desde); break;
+    }
+    // Posiciones de inicio que el recorrido dejo decididas: de 'desde' a la coincidencia o a la ultima que cabe
+    PERFIL_SUMAR(POSICIONES_PROBADAS, (pos == string::npos ? texto.size() - texto_patron.size() + 1 : pos + 1) - desde);
+    return pos;
+}
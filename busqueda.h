@@ -0,0 +1,46 @@
+#ifndef BUSQUEDA_H
+#define BUSQUEDA_H
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+using namespace std;
+
+// Variantes del recorrido de busqueda, de la mas rapida a la mas general
+enum TipoBuscador {
+    BUSCADOR_EXACTO,   // Patron y texto solo con A, C, G, T: la compatibilidad es igualdad (2 bits por base)
+    BUSCADOR_REGISTRO, // Patron de hasta 64 codigos: Shift-And con el estado en un uint64
+    BUSCADOR_LITERAL,  // Patron largo sin X, '-' ni codigos ambiguos: basta la tabla de aceptados
+    BUSCADOR_GENERAL   // Cualquier otro caso: compatibilidad completa posicion por posicion
+};
+
+const int MAX_PATRON_REGISTRO = 64;
+const int MAX_PREFIJO_EXACTO = 32; // Bases del patron que caben en un uint64 a 2 bits por base
+
+// Resumen de las clases de simbolos (CLASE_* en iupac.h) presentes en un texto
+uint8_t resumen_alfabeto(const char* texto, size_t n);
+
+// Busca un patron en un texto con la variante mas rapida que permite el alfabeto de ambos.
+// Se prepara una vez por patron y secuencia; el alfabeto del texto viene del resumen de la secuencia.
+// El patron no se copia: debe seguir vivo mientras se use el buscador
+class Buscador {
+public:
+    Buscador(const string& patron, uint8_t alfabeto_texto);
+
+    // Primera posicion >= desde donde el patron coincide con el texto, o string::npos
+    size_t siguiente(const string& texto, size_t desde) const;
+
+    TipoBuscador tipo() const { return variante; }
+    const string& patron() const { return texto_patron; }
+    const uint64_t* mascaras() const { return mascaras_registro; }
+    uint64_t codigo_prefijo() const { return prefijo; }
+
+private:
+    const string& texto_patron;
+    TipoBuscador variante;
+    uint64_t mascaras_registro[256]; // BUSCADOR_REGISTRO: bit k si el codigo es compatible con patron[k]
+    uint64_t prefijo;                // BUSCADOR_EXACTO: primeras bases del patron a 2 bits por base
+};
+
+#endif
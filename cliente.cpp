@@ -0,0 +1,77 @@
+#include "protocolo.h"
+#include <iostream>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace std;
+
+// Cliente del modo servidor: envia comandos por el socket y muestra las respuestas.
+//   cliente <socket> <comando ...>   ejecuta un solo comando
+//   cliente <socket>                 lee un comando por linea de la entrada estandar
+
+static int conectar(const string& ruta) {
+    struct sockaddr_un direccion;
+    memset(&direccion, 0, sizeof(direccion));
+    direccion.sun_family = AF_UNIX;
+    if (ruta.size() >= sizeof(direccion.sun_path)) return -1;
+    memcpy(direccion.sun_path, ruta.c_str(), ruta.size());
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    if (connect(fd, (struct sockaddr*)&direccion, sizeof(direccion)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Envia un comando y escribe la respuesta; devuelve false si la conexion termino
+static bool consultar(int fd, const string& comando) {
+    string respuesta;
+    if (!enviar_mensaje(fd, comando) || !recibir_mensaje(fd, respuesta, ~0U)) {
+        return false;
+    }
+    cout << respuesta << flush;
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        cerr << "Uso: cliente <socket> [comando ...]\n";
+        return 2;
+    }
+
+    int fd = conectar(argv[1]);
+    if (fd < 0) {
+        cerr << "No se puede conectar con el servidor en " << argv[1] << ".\n";
+        return 1;
+    }
+
+    if (argc > 2) {
+        string comando = argv[2];
+        for (int i = 3; i < argc; i++) {
+            comando += " ";
+            comando += argv[i];
+        }
+        bool correcto = consultar(fd, comando);
+        close(fd);
+        return correcto ? 0 : 1;
+    }
+
+    string linea;
+    bool interactivo = isatty(STDIN_FILENO);
+    while (true) {
+        if (interactivo) cout << "$ " << flush;
+        if (!getline(cin, linea)) break;
+        if (linea.empty()) continue;
+        if (!consultar(fd, linea)) {
+            close(fd);
+            return linea == "salir" || linea == "detener" ? 0 : 1;
+        }
+        if (linea == "salir" || linea == "detener") break;
+    }
+    close(fd);
+    return 0;
+}
@@ -0,0 +1,171 @@
+#include "comandos.h"
+#include "secuencias.h"
+#include "interfaz.h"
+#include "huffman.h"
+#include "grafo.h"
+#include "landmarks.h"
+#include "kmers.h"
+#include "composicion.h"
+#include "perfil.h"
+#include "servidor.h"
+#include "sesion.h"
+
+using namespace std;
+
+// Ejecuta una linea de comando, tanto desde la consola como desde el servidor
+bool ejecutar_comando(const string& input) {
+    string* partes = memoria_sesion().partes; // Partes del comando separadas, en la memoria de la sesion
+    int numPartes;                            // Número real de partes del comando
+
+    numPartes = dividir(input, partes);   // Separar el comando en partes
+    if (numPartes == 0) return true;      // Ignorar líneas vacías
+    const string& comando = partes[0];    // Primer palabra = nombre del comando
+
+    // Comando para salir del programa
+    if (comando == "salir") return false;
+
+    // Las palabras que no caben en partes se perderian (p. ej. archivos de cargar_agregar)
+    if (numPartes > MAX_PARTES) {
+        salida() << "Error: El comando tiene " << numPartes << " palabras y el maximo es " << MAX_PARTES << ".\n";
+        return true;
+    }
+
+    // Estadisticas de los comandos anteriores; perfil no se mide a si mismo
+    if (comando == "perfil") {
+        if (numPartes == 1) perfil();
+        else if (numPartes == 2 && (partes[1] == "json" || partes[1] == "reiniciar")) perfil(partes[1]);
+        else salida() << "Error: Uso correcto -> perfil [json|reiniciar]\n";
+        return true;
+    }
+
+    // Un comando desconocido no se mide: el perfil solo guarda nombres de comandos validos
+    if (!es_comando(comando)) {
+        salida_error() << "Error: Comando no reconocido. Escribe 'ayuda' para ver los comandos válidos.\n";
+        return true;
+    }
+
+    // Al terminar el comando (despues de su medicion) la sesion devuelve la memoria si retiene demasiada
+    FinComandoSesion fin_sesion;
+
+    // Tiempo (y, con PERFIL=1, contadores y memoria) del comando hasta que termine.
+    // El servidor solo envuelve a los comandos de sus clientes, que se miden cada uno por su cuenta
+    MedicionComando medicion(comando, comando == "servidor");
+
+    // Comando de ayuda general o específica
+    if (comando == "ayuda") {
+        if (numPartes == 1) {
+            mostrar_ayuda_general();
+        } else {
+            mostrar_ayuda_comando(partes[1]);
+        }
+
+    // Comandos del Componente 1: Resumen de la información de un genoma
+    } else if (comando == "cargar") {
+        if (numPartes == 2) cargar_archivo(partes[1]);
+        else if (numPartes == 3 && partes[2] == "suave") cargar_archivo(partes[1], true);
+        else salida() << "Error: Uso correcto -> cargar <archivo> [suave]\n";
+
+    } else if (comando == "cargar_agregar") {
+        bool suave = numPartes >= 3 && partes[numPartes - 1] == "suave";
+        int num_archivos = numPartes - 1 - (suave ? 1 : 0);
+        if (num_archivos < 1) salida() << "Error: Uso correcto -> cargar_agregar <archivo> [archivo ...] [suave]\n";
+        else cargar_agregar(partes + 1, num_archivos, suave);
+
+    } else if (comando == "cargar_indexado") {
+        bool suave = numPartes >= 3 && partes[numPartes - 1] == "suave";
+        int num_argumentos = numPartes - (suave ? 1 : 0);
+        if (num_argumentos == 2) cargar_indexado(partes[1], "", suave);
+        else if (num_argumentos == 3) cargar_indexado(partes[1], partes[2], suave);
+        else salida() << "Error: Uso correcto -> cargar_indexado <archivo> [memoria_MB] [suave]\n";
+
+    } else if (comando == "listar_secuencias") {
+        listar_secuencias();
+
+    } else if (comando == "histograma") {
+        if (numPartes != 2) salida() << "Error: Uso correcto -> histograma <descripcion>\n";
+        else histograma(partes[1]);
+
+    } else if (comando == "es_subsecuencia") {
+        if (numPartes == 2) subsecuencia(partes[1]);
+        else if (numPartes == 3 && partes[2] == "ambas") subsecuencia(partes[1], true);
+        else salida() << "Error: Uso correcto -> es_subsecuencia <sub> [ambas]\n";
+
+    } else if (comando == "enmascarar") {
+        bool ambas = false, suave = false, correcto = numPartes >= 2;
+        for (int i = 2; i < numPartes; i++) {
+            if (partes[i] == "ambas") ambas = true;
+            else if (partes[i] == "suave") suave = true;
+            else correcto = false;
+        }
+        if (correcto) enmascarar(partes[1], ambas, suave);
+        else salida() << "Error: Uso correcto -> enmascarar <sub> [ambas] [suave]\n";
+
+    } else if (comando == "ubicar_subsecuencia") {
+        if (numPartes == 2) ubicar_subsecuencia(partes[1]);
+        else if (numPartes == 3) ubicar_subsecuencia(partes[1], partes[2]);
+        else salida() << "Error: Uso correcto -> ubicar_subsecuencia <sub> [archivo_salida]\n";
+
+    } else if (comando == "guardar") {
+        if (numPartes != 2) salida() << "Error: Uso correcto -> guardar <archivo>\n";
+        else guardar_archivo(partes[1]);
+
+    } else if (comando == "kmers") {
+        if (numPartes == 2) kmers(partes[1]);
+        else if (numPartes == 3) kmers(partes[1], partes[2]);
+        else salida() << "Error: Uso correcto -> kmers <k> [descripcion]\n";
+
+    // Comandos del Componente 2: Codificación y decodificación Huffman
+    } else if (comando == "codificar") {
+        bool por_secuencia = false, rachas = false, correcto = numPartes >= 2;
+        for (int i = 2; i < numPartes; i++) {
+            if (partes[i] == "por_secuencia") por_secuencia = true;
+            else if (partes[i] == "rachas") rachas = true;
+            else correcto = false;
+        }
+        if (correcto) codificar(partes[1], por_secuencia, rachas);
+        else salida() << "Error: Uso correcto -> codificar <archivo.fabin> [por_secuencia] [rachas]\n";
+
+    } else if (comando == "decodificar") {
+        if (numPartes != 2) salida() << "Error: Uso correcto -> decodificar <archivo.fabin>\n";
+        else decodificar(partes[1]);
+        
+    } else if (comando == "decodificar_agregar") {
+        if (numPartes < 2) salida() << "Error: Uso correcto -> decodificar_agregar <archivo.fabin> [archivo.fabin ...]\n";
+        else decodificar_agregar(partes + 1, numPartes - 1);
+
+    } else if (comando == "verificar") {
+        if (numPartes != 2) salida() << "Error: Uso correcto -> verificar <archivo.fabin>\n";
+        else verificar(partes[1]);
+    } else if (comando == "perfil_composicion") {
+        if (numPartes != 5) salida() << "Error: Uso correcto -> perfil_composicion <desc|*> <ventana> <paso> <salida>\n";
+        else perfil_composicion(partes[1], partes[2], partes[3], partes[4]);
+        
+    // Comandos del Componente 3: Grafos y rutas
+    } else if (comando == "ruta_mas_corta") {
+        if (numPartes == 6) ruta_mas_corta(partes[1], partes[2], partes[3], partes[4], partes[5]);
+        else if (numPartes == 7 && partes[6] == "exacto") ruta_mas_corta(partes[1], partes[2], partes[3], partes[4], partes[5], true);
+        else salida() << "Error: Uso correcto -> ruta_mas_corta <desc> <i> <j> <x> <y> [exacto]\n";
+
+    } else if (comando == "base_remota") {
+        if (numPartes == 4) base_remota(partes[1], partes[2], partes[3]);
+        else if (numPartes == 5 && partes[4] == "exacto") base_remota(partes[1], partes[2], partes[3], true);
+        else salida() << "Error: Uso correcto -> base_remota <desc> <i> <j> [exacto]\n";
+
+    } else if (comando == "base_remota_todas") {
+        if (numPartes == 3) base_remota_todas(partes[1], partes[2]);
+        else if (numPartes == 4) base_remota_todas(partes[1], partes[2], partes[3]);
+        else salida() << "Error: Uso correcto -> base_remota_todas <desc> <salida> [hilos]\n";
+
+    } else if (comando == "preprocesar_rutas") {
+        if (numPartes != 3) salida() << "Error: Uso correcto -> preprocesar_rutas <desc> <num_landmarks>\n";
+        else preprocesar_rutas(partes[1], partes[2]);
+
+    // Modo servidor: atiende los mismos comandos por un socket local
+    } else if (comando == "servidor") {
+        if (numPartes == 2) servidor(partes[1]);
+        else if (numPartes == 3) servidor(partes[1], partes[2]);
+        else salida() << "Error: Uso correcto -> servidor <socket> [hilos]\n";
+    }
+
+    return true;
+}
@@ -0,0 +1,12 @@
+#ifndef COMANDOS_H
+#define COMANDOS_H
+
+#include <string>
+
+using namespace std;
+
+// Ejecuta una linea de comando escribiendo los mensajes en salida().
+// Devuelve false si el comando es 'salir'
+bool ejecutar_comando(const string& linea);
+
+#endif
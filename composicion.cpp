@@ -0,0 +1,265 @@
+#include "composicion.h"
+#include "secuencias.h"
+#include "binario.h"
+#include "interfaz.h"
+#include "iupac.h"
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+// Contadores de una ventana
+struct Composicion {
+    uint64_t gc;        // G, C y S
+    uint64_t at;        // A, T, U y W
+    uint64_t ambiguas;  // R, Y, K, M, S, W, B, D, H, V y N
+    uint64_t mascara;   // X
+
+    Composicion() : gc(0), at(0), ambiguas(0), mascara(0) {}
+};
+
+// Los cuatro contadores de cada byte empaquetados en un entero de 64 bits (16 bits por contador):
+// sumar los valores de la tabla suma los cuatro contadores a la vez mientras ninguno pase de 65535
+const size_t MAX_BYTES_EMPAQUETADOS = 65535;
+
+struct TablaComposicion {
+    uint64_t valores[256];
+
+    TablaComposicion() {
+        for (int c = 0; c < 256; c++) {
+            uint64_t gc = (c == 'G' || c == 'C' || c == 'S') ? 1 : 0;
+            uint64_t at = (c == 'A' || c == 'T' || c == 'U' || c == 'W') ? 1 : 0;
+            uint64_t ambigua = TABLA_CLASES[c] == CLASE_AMBIGUA ? 1 : 0;
+            uint64_t mascara = c == 'X' ? 1 : 0;
+            valores[c] = gc | (at << 16) | (ambigua << 32) | (mascara << 48);
+        }
+    }
+};
+
+static const TablaComposicion TABLA_COMPOSICION;
+
+// Suma (signo = 1) o resta (signo = -1) a 'total' la composicion de texto[inicio, fin)
+static void acumular(const string& texto, uint64_t inicio, uint64_t fin, int signo, Composicion& total) {
+    const unsigned char* datos = (const unsigned char*)texto.data();
+    while (inicio < fin) {
+        uint64_t tramo = min<uint64_t>(fin - inicio, MAX_BYTES_EMPAQUETADOS);
+        uint64_t suma = 0;
+        for (uint64_t j = inicio; j < inicio + tramo; j++) {
+            suma += TABLA_COMPOSICION.valores[datos[j]];
+        }
+        total.gc += signo * (int64_t)(suma & 0xFFFF);
+        total.at += signo * (int64_t)((suma >> 16) & 0xFFFF);
+        total.ambiguas += signo * (int64_t)((suma >> 32) & 0xFFFF);
+        total.mascara += signo * (int64_t)(suma >> 48);
+        inicio += tramo;
+    }
+}
+
+// Escribe parte / total como porcentaje con dos decimales, o NA si el total es 0
+static void escribir_porcentaje(string& linea, uint64_t parte, uint64_t total) {
+    if (total == 0) {
+        linea += "NA";
+        return;
+    }
+    uint64_t centesimas = (parte * 20000 + total) / (2 * total); // Redondeo al mas cercano
+    linea += to_string(centesimas / 100);
+    linea += '.';
+    linea += (char)('0' + centesimas / 10 % 10);
+    linea += (char)('0' + centesimas % 10);
+}
+
+// Bases de la mascara suave antes de la posicion 'hasta'. 'acumuladas[t]' es la cantidad de bases
+// de los tramos anteriores al tramo t
+static uint64_t suaves_antes(const MascaraSuave& suave, const vector<uint64_t>& acumuladas, uint64_t hasta) {
+    // Primer tramo que empieza en 'hasta' o despues; el anterior puede cubrirlo en parte
+    size_t t = upper_bound(suave.begin(), suave.end(), hasta,
+                           [](uint64_t pos, const IntervaloSuave& tramo) { return pos <= tramo.inicio; }) - suave.begin();
+    if (t == 0) return 0;
+    return acumuladas[t - 1] + min(hasta, suave[t - 1].fin) - suave[t - 1].inicio;
+}
+
+// Cantidad de ventanas de una secuencia: empiezan en 0, paso, 2 * paso, ... y la ultima es la
+// primera que llega al final (puede ser mas corta que la ventana)
+static uint64_t contar_ventanas(uint64_t largo, uint64_t ventana, uint64_t paso) {
+    if (largo == 0) return 0;
+    if (largo <= ventana) return 1;
+    uint64_t hasta_el_final = (largo - ventana + paso - 1) / paso + 1;
+    uint64_t inicios = (largo + paso - 1) / paso; // Con paso > ventana ninguna puede llegar justo al final
+    return min(hasta_el_final, inicios);
+}
+
+// Bloque de ventanas consecutivas de una secuencia
+struct BloqueVentanas {
+    int secuencia;
+    uint64_t primera;
+    uint64_t cantidad;
+};
+
+// Estado compartido por los hilos. Los bloques terminan en cualquier orden y se escriben en orden
+struct EstadoComposicion {
+    const vector<Secuencia>* secuencias;
+    vector<int> seleccionadas;
+    vector<Bases> bases;                 // Bases de cada seleccionada, vivas durante todo el comando
+    vector<vector<uint64_t> > acumuladas; // Bases de la mascara suave antes de cada tramo, por seleccionada
+    vector<BloqueVentanas> bloques;
+    uint64_t ventana;
+    uint64_t paso;
+    atomic<size_t> siguiente;            // Proximo bloque por repartir
+
+    mutex candado;
+    EscritorBinario* archivo;
+    size_t escritos;                     // Bloques ya escritos en el archivo
+    map<size_t, string> listos;          // Bloques terminados que esperan a los anteriores
+};
+
+static void calcular_bloque(const EstadoComposicion& estado, const BloqueVentanas& bloque, string& lineas) {
+    const string& descripcion = (*estado.secuencias)[estado.seleccionadas[bloque.secuencia]].descripcion;
+    const string& texto = estado.bases[bloque.secuencia]->texto;
+    const MascaraSuave& suave = estado.bases[bloque.secuencia]->suave;
+    const vector<uint64_t>& acumuladas = estado.acumuladas[bloque.secuencia];
+    uint64_t largo = texto.size();
+
+    // La primera ventana se cuenta completa; cada siguiente suma lo que entra y resta lo que sale
+    Composicion actual;
+    uint64_t inicio = bloque.primera * estado.paso;
+    uint64_t fin = min(largo, inicio + estado.ventana);
+    acumular(texto, inicio, fin, 1, actual);
+    for (uint64_t v = 0; v < bloque.cantidad; v++) {
+        if (v > 0) {
+            uint64_t nuevo_inicio = inicio + estado.paso;
+            uint64_t nuevo_fin = min(largo, nuevo_inicio + estado.ventana);
+            if (nuevo_inicio < fin) {
+                acumular(texto, fin, nuevo_fin, 1, actual);
+                acumular(texto, inicio, nuevo_inicio, -1, actual);
+            } else {
+                actual = Composicion(); // Paso mayor que la ventana: las ventanas no se solapan
+                acumular(texto, nuevo_inicio, nuevo_fin, 1, actual);
+            }
+            inicio = nuevo_inicio;
+            fin = nuevo_fin;
+        }
+
+        lineas += descripcion;
+        lineas += '\t';
+        lineas += to_string(inicio);
+        lineas += '\t';
+        lineas += to_string(fin);
+        lineas += '\t';
+        escribir_porcentaje(lineas, actual.gc, actual.gc + actual.at);
+        lineas += '\t';
+        escribir_porcentaje(lineas, actual.ambiguas, fin - inicio);
+        lineas += '\t';
+        escribir_porcentaje(lineas, actual.mascara, fin - inicio);
+        lineas += '\t';
+        escribir_porcentaje(lineas, suaves_antes(suave, acumuladas, fin) - suaves_antes(suave, acumuladas, inicio),
+                            fin - inicio);
+        lineas += '\n';
+    }
+}
+
+static void hilo_composicion(EstadoComposicion& estado) {
+    string lineas;
+    while (true) {
+        size_t b = estado.siguiente++;
+        if (b >= estado.bloques.size()) return;
+        lineas.clear();
+        calcular_bloque(estado, estado.bloques[b], lineas);
+
+        lock_guard<mutex> bloqueo(estado.candado);
+        estado.listos[b].swap(lineas);
+        while (!estado.listos.empty() && estado.listos.begin()->first == estado.escritos) {
+            const string& listo = estado.listos.begin()->second;
+            estado.archivo->escribir_bytes(listo.data(), listo.size());
+            estado.listos.erase(estado.listos.begin());
+            estado.escritos++;
+        }
+    }
+}
+
+// Comando: perfil_composicion
+void perfil_composicion(string descripcion, string ventana_str, string paso_str, string nombreArchivo) {
+    Instantanea version = instantanea();
+    const vector<Secuencia>& secuencias = version->secuencias;
+    if (secuencias.empty()) {
+        salida() << "No hay secuencias cargadas en memoria.\n";
+        return;
+    }
+
+    EstadoComposicion estado;
+    try {
+        estado.ventana = stoull(ventana_str);
+        estado.paso = stoull(paso_str);
+    } catch (...) {
+        estado.ventana = 0;
+        estado.paso = 0;
+    }
+    if (estado.ventana == 0 || estado.paso == 0 || ventana_str[0] == '-' || paso_str[0] == '-') {
+        salida() << "Error: La ventana y el paso deben ser enteros positivos.\n";
+        return;
+    }
+
+    // Secuencias a perfilar (todas con '*')
+    if (descripcion == "*") {
+        for (size_t i = 0; i < secuencias.size(); i++) {
+            estado.seleccionadas.push_back(i);
+        }
+    } else {
+        int indice = version->buscar(descripcion);
+        if (indice == -1) {
+            salida() << "La secuencia " << descripcion << " no existe.\n";
+            return;
+        }
+        estado.seleccionadas.push_back(indice);
+    }
+
+    uint64_t total_ventanas = 0;
+    for (size_t s = 0; s < estado.seleccionadas.size(); s++) {
+        estado.bases.push_back(bases_de(secuencias[estado.seleccionadas[s]]));
+        const MascaraSuave& suave = estado.bases.back()->suave;
+        estado.acumuladas.push_back(vector<uint64_t>(suave.size()));
+        for (size_t t = 1; t < suave.size(); t++) {
+            estado.acumuladas.back()[t] = estado.acumuladas.back()[t - 1] + suave[t - 1].fin - suave[t - 1].inicio;
+        }
+        uint64_t ventanas = contar_ventanas(estado.bases.back()->texto.size(), estado.ventana, estado.paso);
+        for (uint64_t v = 0; v < ventanas; v += VENTANAS_POR_BLOQUE) {
+            estado.bloques.push_back({(int)s, v, min<uint64_t>(VENTANAS_POR_BLOQUE, ventanas - v)});
+        }
+        total_ventanas += ventanas;
+    }
+
+    EscritorBinario archivo;
+    if (!archivo.abrir(nombreArchivo)) {
+        salida() << "Error guardando en " << nombreArchivo << ".\n";
+        return;
+    }
+    const string encabezado = "descripcion\tinicio\tfin\tgc\tambiguas\tmascara\tsuave\n";
+    archivo.escribir_bytes(encabezado.data(), encabezado.size());
+
+    estado.secuencias = &secuencias;
+    estado.siguiente = 0;
+    estado.archivo = &archivo;
+    estado.escritos = 0;
+
+    int num_hilos = thread::hardware_concurrency();
+    if (num_hilos < 1) num_hilos = 1;
+    if ((size_t)num_hilos > estado.bloques.size()) num_hilos = max<size_t>(1, estado.bloques.size());
+    vector<thread> hilos;
+    for (int t = 1; t < num_hilos; t++) {
+        hilos.push_back(thread(hilo_composicion, ref(estado)));
+    }
+    hilo_composicion(estado);
+    for (size_t t = 0; t < hilos.size(); t++) {
+        hilos[t].join();
+    }
+
+    if (!archivo.cerrar()) {
+        salida() << "Error guardando en " << nombreArchivo << ".\n";
+        return;
+    }
+    salida() << "Se escribio la composicion de " << total_ventanas << " ventanas de " << estado.seleccionadas.size()
+             << " secuencias en " << nombreArchivo << ".\n";
+}
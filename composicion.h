@@ -0,0 +1,16 @@
+#ifndef COMPOSICION_H
+#define COMPOSICION_H
+
+#include <string>
+
+using namespace std;
+
+const int VENTANAS_POR_BLOQUE = 4096; // Unidad de reparto entre hilos
+
+// Comando: perfil_composicion <desc|*> <ventana> <paso> <salida>
+// Escribe en TSV, para cada ventana de 'ventana' bases que avanza de a 'paso' bases, su contenido de GC,
+// la densidad de codigos ambiguos y la cobertura de la mascara X y de la mascara suave. Las secuencias (todas con '*') se
+// reparten en bloques de ventanas entre los hilos y los bloques se escriben en orden a medida que terminan
+void perfil_composicion(string descripcion, string ventana_str, string paso_str, string nombreArchivo);
+
+#endif
@@ -0,0 +1,79 @@
+#include "crc32c.h"
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <nmmintrin.h>
+#define CRC32C_X86 1
+#endif
+
+using namespace std;
+
+const uint32_t POLINOMIO_CRC32C = 0x82F63B78; // 0x1EDC6F41 reflejado
+
+// Tabla de la version por software, calculada una sola vez
+struct TablaCrc32c {
+    uint32_t valores[256];
+
+    TablaCrc32c() {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int b = 0; b < 8; b++) {
+                c = (c & 1) ? (c >> 1) ^ POLINOMIO_CRC32C : c >> 1;
+            }
+            valores[i] = c;
+        }
+    }
+};
+
+static uint32_t crc32c_tabla(uint32_t crc, const uint8_t* p, size_t n) {
+    static const TablaCrc32c tabla;
+    crc = ~crc;
+    while (n-- > 0) {
+        crc = tabla.valores[(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+#ifdef CRC32C_X86
+// Se compila para SSE4.2 aunque el resto del programa no lo use; solo se llama si el procesador lo tiene
+__attribute__((target("sse4.2")))
+static uint32_t crc32c_sse42(uint32_t crc, const uint8_t* p, size_t n) {
+    crc = ~crc;
+#ifdef __x86_64__
+    uint64_t crc64 = crc;
+    while (n >= 8) {
+        uint64_t palabra;
+        memcpy(&palabra, p, 8);
+        crc64 = _mm_crc32_u64(crc64, palabra);
+        p += 8;
+        n -= 8;
+    }
+    crc = (uint32_t)crc64;
+#endif
+    while (n >= 4) {
+        uint32_t palabra;
+        memcpy(&palabra, p, 4);
+        crc = _mm_crc32_u32(crc, palabra);
+        p += 4;
+        n -= 4;
+    }
+    while (n-- > 0) {
+        crc = _mm_crc32_u8(crc, *p++);
+    }
+    return ~crc;
+}
+#endif
+
+typedef uint32_t (*FuncionCrc32c)(uint32_t, const uint8_t*, size_t);
+
+static FuncionCrc32c elegir_crc32c() {
+#ifdef CRC32C_X86
+    if (__builtin_cpu_supports("sse4.2")) return crc32c_sse42;
+#endif
+    return crc32c_tabla;
+}
+
+uint32_t crc32c(uint32_t crc, const void* datos, size_t n) {
+    static const FuncionCrc32c funcion = elegir_crc32c();
+    return funcion(crc, static_cast<const uint8_t*>(datos), n);
+}
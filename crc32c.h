@@ -0,0 +1,12 @@
+#ifndef CRC32C_H
+#define CRC32C_H
+
+#include <cstdint>
+#include <cstddef>
+
+// CRC32C (polinomio de Castagnoli, el mismo de iSCSI y ext4). En procesadores con SSE4.2 usa la
+// instruccion crc32; si no, una tabla por byte. 'crc' es el valor acumulado: 0 para empezar y el
+// resultado anterior para continuar con los bytes siguientes
+uint32_t crc32c(uint32_t crc, const void* datos, size_t n);
+
+#endif
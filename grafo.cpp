@@ -1,7 +1,21 @@
 #include "grafo.h"
 #include "secuencias.h"
+#include "perfil.h"
+#include "interfaz.h"
+#include "landmarks.h"
+#include "sesion.h"
 #include <iostream>
 #include <cmath>
+#include <algorithm>
+#include <functional>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <map>
+#include <chrono>
+#include "binario.h"
 
 using namespace std;
 
@@ -13,262 +27,461 @@ double calcular_peso_arista(char base1, char base2) { // Retorno en double, dado
     return 1.0 / (1.0 + diferencia); // Division con punto flotante (Se fuese 1 y no 1.0 retornaria siempre 0 o 1 aproximando)
 }
 
-// Verificar si una posicion es valida en el grafo
+// Peso de arista para cada diferencia ASCII |base1 - base2|; son los mismos valores de calcular_peso_arista
+struct TablaPesos {
+    double peso[256];
+
+    TablaPesos() {
+        for (int d = 0; d < 256; d++) peso[d] = 1.0 / (1.0 + d);
+    }
+};
+static const TablaPesos PESOS_ARISTA;
+
+// Verificar si una posicion es valida en el grafo (la ultima fila puede estar incompleta)
 bool posicion_valida(const GrafoSecuencia& grafo, int i, int j) {
-    return i >= 0 && i < grafo.filas && j >= 0 && j < grafo.columnas;
+    return i >= 0 && i < grafo.filas && j >= 0 && j < grafo.columnas && i * grafo.columnas + j < grafo.total;
+}
+
+// Log2 de la menor potencia de 2 que es >= n, sin pasar de 'maximo'
+static int bits_para(int n, int maximo) {
+    int bits = 0;
+    while (bits < maximo && (1 << bits) < n) bits++;
+    return bits;
 }
 
 // Construir el grafo a partir de una secuencia de bases
 GrafoSecuencia construir_grafo(const string& secuencia_bases, int ancho_linea) {
     GrafoSecuencia grafo;
-    
+    construir_grafo(secuencia_bases, ancho_linea, grafo);
+    return grafo;
+}
+
+// Construir el grafo sobre uno existente; si ya tenia reservada la memoria necesaria no se vuelve a pedir
+void construir_grafo(const string& secuencia_bases, int ancho_linea, GrafoSecuencia& grafo) {
     // Calcular dimensiones de la matriz
     int total_bases = secuencia_bases.size();
+    grafo.total = total_bases;
     grafo.columnas = ancho_linea;
     grafo.filas = (total_bases + ancho_linea - 1) / ancho_linea; // Redondeo hacia arriba
-    
-    // Inicializar la matriz de nodos
-    grafo.matriz.resize(grafo.filas);
+    grafo.paso[VECINO_ARRIBA] = -ancho_linea;
+    grafo.paso[VECINO_IZQUIERDA] = -1;
+    grafo.paso[VECINO_DERECHA] = 1;
+    grafo.paso[VECINO_ABAJO] = ancho_linea;
+    
+    // Bloques de 64 nodos, 8x8 si la matriz lo permite; una matriz de pocas filas o pocas columnas
+    // usa bloques mas anchos o mas altos para no llenarse de relleno
+    grafo.bits_alto = bits_para(grafo.filas, 3);
+    grafo.bits_ancho = bits_para(grafo.columnas, 6 - grafo.bits_alto);
+    grafo.bits_alto = bits_para(grafo.filas, 6 - grafo.bits_ancho);
+    grafo.bloques_por_fila = (grafo.columnas + (1 << grafo.bits_ancho) - 1) >> grafo.bits_ancho;
+    int filas_de_bloques = (grafo.filas + (1 << grafo.bits_alto) - 1) >> grafo.bits_alto;
+    grafo.tam = (filas_de_bloques * grafo.bloques_por_fila) << (grafo.bits_ancho + grafo.bits_alto);
+    
+    // Bases y mascaras en una sola reserva; el relleno queda en 0 (sin vecinos)
+    grafo.datos.assign(2 * (size_t)grafo.tam, 0);
+    uint8_t* mascaras = grafo.datos.data() + grafo.tam;
+    
+    // Una pasada por fila: la mascara solo depende de si el nodo esta en un borde
     for (int i = 0; i < grafo.filas; i++) {
-        grafo.matriz[i].resize(grafo.columnas);
+        int inicio = i * ancho_linea;
+        int fin = min(total_bases, inicio + ancho_linea);
+        for (int idx = inicio; idx < fin; idx++) {
+            int nodo = grafo.nodo(i, idx - inicio);
+            grafo.datos[nodo] = secuencia_bases[idx];
+            mascaras[nodo] = (i > 0 ? (1 << VECINO_ARRIBA) : 0) | (idx > inicio ? (1 << VECINO_IZQUIERDA) : 0) |
+                             (idx + 1 < fin ? (1 << VECINO_DERECHA) : 0) |
+                             (idx + ancho_linea < total_bases ? (1 << VECINO_ABAJO) : 0);
+        }
     }
-    
-    // Llenar la matriz con las bases
-    for (int idx = 0; idx < total_bases; idx++) {
-        int fila = idx / ancho_linea;
-        int columna = idx % ancho_linea;
-        grafo.matriz[fila][columna] = NodoGrafo(secuencia_bases[idx], fila, columna);
+}
+
+// Predecesores de 2 bits: la direccion en que esta el predecesor de cada nodo, cuatro por byte
+static inline void fijar_predecesor(vector<uint8_t>& predecesor, int nodo, int direccion) {
+    uint8_t& byte = predecesor[nodo >> 2];
+    int corrimiento = (nodo & 3) * 2;
+    byte = (byte & ~(3 << corrimiento)) | (direccion << corrimiento);
+}
+
+static inline int predecesor_de(const vector<uint8_t>& predecesor, int nodo) {
+    return (predecesor[nodo >> 2] >> ((nodo & 3) * 2)) & 3;
+}
+
+size_t MemoriaBusqueda::bytes_reservados() const {
+    size_t bytes = distancia.capacity() * sizeof(double) + distancia_entera.capacity() * sizeof(uint64_t) +
+                   predecesor.capacity() + cola.capacity() * sizeof(EntradaCola) + camino.capacity() * sizeof(int);
+    for (int i = 0; i < 65; i++) {
+        bytes += cubetas[i].capacity() * sizeof(pair<uint64_t, int>);
     }
-    
-    // Construir las conexiones (aristas) para cada nodo
-    for (int i = 0; i < grafo.filas; i++) {
-        for (int j = 0; j < grafo.columnas; j++) {
-            // Verificar que este nodo tenga una base valida
-            int idx = i * ancho_linea + j;
-            if (idx >= total_bases) continue;
-            
-            char base_actual = grafo.matriz[i][j].base;
-            
-            // Conectar con vecino superior [i-1, j]
-            if (i > 0) {
-                int idx_superior = (i - 1) * ancho_linea + j;
-                if (idx_superior < total_bases) {
-                    char base_vecino = grafo.matriz[i-1][j].base;
-                    double peso = calcular_peso_arista(base_actual, base_vecino);
-                    grafo.matriz[i][j].vecinos.push_back(Arista(Posicion(i-1, j), peso));
-                }
-            }
-            
-            // Conectar con vecino inferior [i+1, j]
-            if (i < grafo.filas - 1) {
-                int idx_inferior = (i + 1) * ancho_linea + j;
-                if (idx_inferior < total_bases) {
-                    char base_vecino = grafo.matriz[i+1][j].base;
-                    double peso = calcular_peso_arista(base_actual, base_vecino);
-                    grafo.matriz[i][j].vecinos.push_back(Arista(Posicion(i+1, j), peso));
-                }
-            }
-            
-            // Conectar con vecino derecho [i, j-1] 
-            if (j > 0) {
-                int idx_derecho = i * ancho_linea + (j - 1);
-                if (idx_derecho < total_bases) {
-                    char base_vecino = grafo.matriz[i][j-1].base;
-                    double peso = calcular_peso_arista(base_actual, base_vecino);
-                    grafo.matriz[i][j].vecinos.push_back(Arista(Posicion(i, j-1), peso));
-                }
-            }
-            
-            // Conectar con vecino izquierdo [i, j+1] 
-            if (j < grafo.columnas - 1) {
-                int idx_izquierdo = i * ancho_linea + (j + 1);
-                if (idx_izquierdo < total_bases) {
-                    char base_vecino = grafo.matriz[i][j+1].base;
-                    double peso = calcular_peso_arista(base_actual, base_vecino);
-                    grafo.matriz[i][j].vecinos.push_back(Arista(Posicion(i, j+1), peso));
-                }
+    return bytes;
+}
+
+// Busqueda de caminos minimos desde el nodo 'origen'.
+// Con landmarks es A* guiado por las cotas ALT; sin ellos (alt == nullptr) es Dijkstra con cola binaria.
+// Se detiene al asentar 'destino' o recorre todo el grafo si destino es -1
+static void buscar_caminos(const GrafoSecuencia& grafo, int origen, int destino, const LandmarksRuta* alt,
+                           MemoriaBusqueda& memoria) {
+    vector<double>& distancia = memoria.distancia;
+    vector<uint8_t>& predecesor = memoria.predecesor;
+    vector<EntradaCola>& cola = memoria.cola;
+    distancia.assign(grafo.tam, INFINITO);
+    predecesor.resize((grafo.tam + 3) / 4); // No hace falta limpiarlo: solo se leen nodos alcanzados
+    cola.clear();
+
+    CotasRuta cotas(alt, destino == -1 ? -1 : grafo.orden(destino)); // Los landmarks van en orden fila-mayor
+    uint64_t asentados = 0, relajadas = 0; // Solo para el perfil
+
+    distancia[origen] = 0.0;
+    int orden_origen = grafo.orden(origen);
+    cola.push_back(EntradaCola(cotas.cota(orden_origen), orden_origen, origen));
+
+    while (!cola.empty()) {
+        pop_heap(cola.begin(), cola.end(), greater<EntradaCola>());
+        EntradaCola entrada = cola.back();
+        cola.pop_back();
+        int actual = entrada.nodo;
+
+        // Entrada obsoleta: el nodo ya se volvio a encolar con una distancia menor
+        if (entrada.clave != distancia[actual] + cotas.cota(entrada.orden)) continue;
+        asentados++;
+
+        // Si llegamos al destino, podemos terminar
+        if (actual == destino) break;
+
+        // Explorar vecinos: un bit de la mascara por cada uno que existe
+        char base_actual = grafo.base(actual);
+        for (uint8_t mascara = grafo.vecinos(actual); mascara != 0; mascara &= mascara - 1) {
+            int direccion = __builtin_ctz(mascara);
+            int vecino = grafo.vecino(actual, direccion);
+            double nueva_distancia = distancia[actual] + PESOS_ARISTA.peso[abs(base_actual - grafo.base(vecino))];
+
+            if (nueva_distancia < distancia[vecino]) {
+                int orden_vecino = entrada.orden + grafo.paso[direccion];
+                distancia[vecino] = nueva_distancia;
+                fijar_predecesor(predecesor, vecino, 3 - direccion);
+                cola.push_back(EntradaCola(nueva_distancia + cotas.cota(orden_vecino), orden_vecino, vecino));
+                push_heap(cola.begin(), cola.end(), greater<EntradaCola>());
+                relajadas++;
             }
         }
     }
-    
-    return grafo;
+
+    PERFIL_SUMAR(NODOS_ASENTADOS, asentados);
+    PERFIL_SUMAR(ARISTAS_RELAJADAS, relajadas);
 }
 
-// Implementacion del algoritmo de Dijkstra con busqueda lineal
-ResultadoRuta dijkstra(const GrafoSecuencia& grafo, Posicion origen, Posicion destino) {
-    ResultadoRuta resultado;
-    
-    // Validar posiciones
-    if (!posicion_valida(grafo, origen.fila, origen.columna) ||
-        !posicion_valida(grafo, destino.fila, destino.columna)) {
-        return resultado;
+// Pesos enteros para el modo exacto: peso(d) = denominador / (1 + d) para cada diferencia ASCII d
+// entre bases presentes en la secuencia, de modo que cada costo es un entero sobre 'denominador'.
+// El denominador es el minimo comun multiplo de los (1 + d); si no cabe con margen para sumar una ruta
+// que pase por todos los nodos, se usa el mayor denominador que cabe y los pesos se redondean (punto fijo)
+struct PesosEnteros {
+    uint64_t denominador;
+    bool exactos;          // false si los pesos estan redondeados
+    uint64_t peso[256];    // Por diferencia |base1 - base2|
+};
+
+static uint64_t mcd(uint64_t a, uint64_t b) {
+    while (b != 0) {
+        uint64_t r = a % b;
+        a = b;
+        b = r;
     }
-    
-    // Matrices para almacenar distancias y predecesores
-    vector<vector<double>> distancia(grafo.filas, vector<double>(grafo.columnas, INFINITO));
-    vector<vector<Posicion>> predecesor(grafo.filas, vector<Posicion>(grafo.columnas, Posicion(-1, -1)));
-    vector<vector<bool>> visitado(grafo.filas, vector<bool>(grafo.columnas, false));
-    
-    // Inicializar el nodo origen
-    distancia[origen.fila][origen.columna] = 0.0;
-    
-    // Procesar todos los nodos
-    for (int count = 0; count < grafo.filas * grafo.columnas; count++) {
-        // Busqueda lineal: Encontrar el nodo no visitado con menor distancia
-        Posicion actual(-1, -1);
-        double min_distancia = INFINITO;
-        
-        for (int i = 0; i < grafo.filas; i++) {
-            for (int j = 0; j < grafo.columnas; j++) {
-                if (!visitado[i][j] && distancia[i][j] < min_distancia) {
-                    min_distancia = distancia[i][j];
-                    actual = Posicion(i, j);
-                }
+    return a;
+}
+
+static PesosEnteros calcular_pesos_enteros(const GrafoSecuencia& grafo) {
+    bool presente[256] = {false};
+    uint64_t nodos = grafo.total;
+    for (int idx = 0; idx < grafo.total; idx++) {
+        presente[(unsigned char)grafo.base(grafo.nodo(idx / grafo.columnas, idx % grafo.columnas))] = true;
+    }
+    bool diferencia[256] = {false};
+    for (int a = 0; a < 256; a++) {
+        for (int b = a; b < 256 && presente[a]; b++) {
+            if (presente[b]) diferencia[abs((signed char)a - (signed char)b)] = true; // Igual que calcular_peso_arista
+        }
+    }
+
+    PesosEnteros pesos;
+    uint64_t limite = (UINT64_MAX / 4) / (nodos > 0 ? nodos : 1); // Ninguna suma de una ruta simple lo desborda
+    pesos.denominador = 1;
+    pesos.exactos = true;
+    for (int d = 0; d < 256 && pesos.exactos; d++) {
+        if (!diferencia[d]) continue;
+        uint64_t factor = (d + 1) / mcd(pesos.denominador, d + 1);
+        if (pesos.denominador > limite / factor) {
+            pesos.exactos = false;
+        } else {
+            pesos.denominador *= factor;
+        }
+    }
+    if (!pesos.exactos) pesos.denominador = limite;
+
+    for (int d = 0; d < 256; d++) {
+        pesos.peso[d] = pesos.exactos ? pesos.denominador / (d + 1) : (pesos.denominador + (d + 1) / 2) / (d + 1);
+    }
+    return pesos;
+}
+
+// Cola de prioridad monotona de claves enteras (radix heap). Las claves nunca bajan de la ultima
+// extraida, asi que cada elemento vive en la cubeta del bit mas alto en que difiere de ella y solo
+// se redistribuye cuando su cubeta pasa a ser la primera no vacia: a lo sumo 64 veces por elemento.
+// Las 65 cubetas son de la memoria de la busqueda, asi que conservan sus reservas entre busquedas
+class MonticuloRadix {
+public:
+    MonticuloRadix(vector<pair<uint64_t, int>>* cubetas) : ultimo(0), tam(0), cubetas(cubetas) {
+        for (int i = 0; i < 65; i++) {
+            cubetas[i].clear();
+        }
+    }
+
+    bool vacio() const { return tam == 0; }
+
+    void insertar(uint64_t clave, int nodo) {
+        cubetas[cubeta(clave)].push_back(make_pair(clave, nodo));
+        tam++;
+    }
+
+    pair<uint64_t, int> extraer() {
+        if (cubetas[0].empty()) {
+            int i = 1;
+            while (cubetas[i].empty()) i++;
+            vector<pair<uint64_t, int>>& origen = cubetas[i];
+            ultimo = origen[0].first;
+            for (size_t k = 1; k < origen.size(); k++) {
+                ultimo = min(ultimo, origen[k].first);
             }
+            for (size_t k = 0; k < origen.size(); k++) {
+                cubetas[cubeta(origen[k].first)].push_back(origen[k]);
+            }
+            origen.clear();
         }
-        
-        // Si no hay mas nodos alcanzables, terminar
-        if (actual.fila == -1) break;
-        
-        int i = actual.fila;
-        int j = actual.columna;
-        visitado[i][j] = true;
-        
+        pair<uint64_t, int> minimo = cubetas[0].back();
+        cubetas[0].pop_back();
+        tam--;
+        return minimo;
+    }
+
+private:
+    uint64_t ultimo;
+    size_t tam;
+    vector<pair<uint64_t, int>>* cubetas;
+
+    int cubeta(uint64_t clave) const {
+        return clave == ultimo ? 0 : 64 - __builtin_clzll(clave ^ ultimo);
+    }
+};
+
+const uint64_t INFINITO_ENTERO = UINT64_MAX;
+
+// Dijkstra exacto sobre los pesos enteros. El predecesor de cada nodo es el vecino de menor indice entre
+// los que dan su distancia minima, asi que la ruta no depende del orden en que la cola resuelva empates.
+// Como las direcciones siguen el orden fila-mayor de los vecinos, basta comparar direcciones
+static void buscar_caminos_exactos(const GrafoSecuencia& grafo, int origen, int destino, const PesosEnteros& pesos,
+                                   MemoriaBusqueda& memoria) {
+    vector<uint64_t>& distancia = memoria.distancia_entera;
+    vector<uint8_t>& predecesor = memoria.predecesor;
+    distancia.assign(grafo.tam, INFINITO_ENTERO);
+    predecesor.resize((grafo.tam + 3) / 4);
+
+    uint64_t asentados = 0, relajadas = 0; // Solo para el perfil
+
+    MonticuloRadix cola(memoria.cubetas);
+    distancia[origen] = 0;
+    cola.insertar(0, origen);
+
+    while (!cola.vacio()) {
+        pair<uint64_t, int> entrada = cola.extraer();
+        int actual = entrada.second;
+
+        // Entrada obsoleta: el nodo ya se volvio a encolar con una distancia menor
+        if (entrada.first != distancia[actual]) continue;
+        asentados++;
+
         // Si llegamos al destino, podemos terminar
         if (actual == destino) break;
-        
+
         // Explorar vecinos
-        const NodoGrafo& nodo = grafo.matriz[i][j];
-        for (const Arista& arista : nodo.vecinos) {
-            int vi = arista.destino.fila;
-            int vj = arista.destino.columna;
-            
-            if (visitado[vi][vj]) continue;
-            
-            double nueva_distancia = distancia[i][j] + arista.peso;
-            
-            if (nueva_distancia < distancia[vi][vj]) {
-                distancia[vi][vj] = nueva_distancia;
-                predecesor[vi][vj] = Posicion(i, j);
+        char base_actual = grafo.base(actual);
+        for (uint8_t mascara = grafo.vecinos(actual); mascara != 0; mascara &= mascara - 1) {
+            int direccion = __builtin_ctz(mascara);
+            int vecino = grafo.vecino(actual, direccion);
+            uint64_t nueva_distancia = distancia[actual] + pesos.peso[abs(base_actual - grafo.base(vecino))];
+
+            if (nueva_distancia < distancia[vecino]) {
+                distancia[vecino] = nueva_distancia;
+                fijar_predecesor(predecesor, vecino, 3 - direccion);
+                cola.insertar(nueva_distancia, vecino);
+                relajadas++;
+            } else if (nueva_distancia == distancia[vecino] && 3 - direccion < predecesor_de(predecesor, vecino)) {
+                fijar_predecesor(predecesor, vecino, 3 - direccion);
             }
         }
     }
-    
+
+    PERFIL_SUMAR(NODOS_ASENTADOS, asentados);
+    PERFIL_SUMAR(ARISTAS_RELAJADAS, relajadas);
+}
+
+// Reconstruye en 'resultado' la ruta de origen a destino siguiendo los predecesores.
+// Los vectores del resultado se vacian y se vuelven a llenar, sin soltar lo que ya tenian reservado
+template <typename T>
+static void reconstruir_ruta(const GrafoSecuencia& grafo, int origen, int destino, const vector<T>& distancia,
+                             T infinito, MemoriaBusqueda& memoria, ResultadoRuta& resultado) {
+    resultado.camino.clear();
+    resultado.bases.clear();
+    resultado.costo_total = 0.0;
+    resultado.existe = false;
+    resultado.costo_entero = 0;
+    resultado.denominador = 0;
+    resultado.costo_exacto = false;
+
     // Verificar si existe un camino al destino
-    if (distancia[destino.fila][destino.columna] == INFINITO) {
-        return resultado;
+    if (distancia[destino] == infinito) {
+        return;
     }
-    
-    // Reconstruir el camino desde destino hacia origen
-    vector<Posicion> camino_inverso;
-    Posicion actual = destino;
-    
-    while (!(actual == origen)) {
+
+    vector<int>& camino_inverso = memoria.camino;
+    camino_inverso.clear();
+    for (int actual = destino; actual != origen; actual = grafo.vecino(actual, predecesor_de(memoria.predecesor, actual))) {
         camino_inverso.push_back(actual);
-        actual = predecesor[actual.fila][actual.columna];
-        
-        // Verificacion de seguridad
-        if (actual.fila == -1 && actual.columna == -1) {
-            return resultado;
-        }
     }
     camino_inverso.push_back(origen);
-    
+
     // Invertir el camino para que vaya de origen a destino
     for (int i = camino_inverso.size() - 1; i >= 0; i--) {
-        resultado.camino.push_back(camino_inverso[i]);
-        Posicion& pos = camino_inverso[i];
-        resultado.bases.push_back(grafo.matriz[pos.fila][pos.columna].base);
+        resultado.camino.push_back(grafo.posicion(camino_inverso[i]));
+        resultado.bases.push_back(grafo.base(camino_inverso[i]));
     }
-    
-    resultado.costo_total = distancia[destino.fila][destino.columna];
+
+    resultado.costo_total = distancia[destino];
     resultado.existe = true;
-    
-    return resultado;
 }
 
-// Encontrar la base remota (misma letra, mas lejana)
-Posicion encontrar_base_remota(const GrafoSecuencia& grafo, Posicion origen) {
-    char base_buscada = grafo.matriz[origen.fila][origen.columna].base;
-    Posicion mejor_remota(-1, -1);
-    double mayor_distancia = -1.0;
-    
-    // Calcular distancias desde el origen a todos los nodos usando busqueda lineal
-    vector<vector<double>> distancia(grafo.filas, vector<double>(grafo.columnas, INFINITO));
-    vector<vector<bool>> visitado(grafo.filas, vector<bool>(grafo.columnas, false));
-    
-    distancia[origen.fila][origen.columna] = 0.0;
-    
-    // Procesar todos los nodos
-    for (int count = 0; count < grafo.filas * grafo.columnas; count++) {
-        // Busqueda lineal: Encontrar el nodo no visitado con menor distancia
-        Posicion actual(-1, -1);
-        double min_distancia = INFINITO;
-        
-        for (int i = 0; i < grafo.filas; i++) {
-            for (int j = 0; j < grafo.columnas; j++) {
-                if (!visitado[i][j] && distancia[i][j] < min_distancia) {
-                    min_distancia = distancia[i][j];
-                    actual = Posicion(i, j);
-                }
+// Misma ruta con el costo expresado como fraccion entera
+static void reconstruir_ruta_exacta(const GrafoSecuencia& grafo, int origen, int destino, const PesosEnteros& pesos,
+                                    MemoriaBusqueda& memoria, ResultadoRuta& resultado) {
+    reconstruir_ruta(grafo, origen, destino, memoria.distancia_entera, INFINITO_ENTERO, memoria, resultado);
+    if (resultado.existe) {
+        resultado.costo_entero = memoria.distancia_entera[destino];
+        resultado.denominador = pesos.denominador;
+        resultado.costo_exacto = pesos.exactos;
+        resultado.costo_total = (double)resultado.costo_entero / resultado.denominador;
+    }
+}
+
+// Base de la misma letra a mayor distancia; a igual distancia gana la de menor indice fila-mayor,
+// que es la que asentaba primero la antigua busqueda lineal
+template <typename T>
+static int elegir_remota(const GrafoSecuencia& grafo, int origen, const vector<T>& distancia, T infinito) {
+    char base_buscada = grafo.base(origen);
+    int mejor_remota = -1;
+    for (int i = 0; i < grafo.filas; i++) {
+        int largo_fila = min(grafo.columnas, grafo.total - i * grafo.columnas);
+        for (int j = 0; j < largo_fila; j++) {
+            int nodo = grafo.nodo(i, j);
+            if (nodo == origen || distancia[nodo] == infinito) continue;
+            if (grafo.base(nodo) == base_buscada &&
+                (mejor_remota == -1 || distancia[nodo] > distancia[mejor_remota])) {
+                mejor_remota = nodo;
             }
         }
-        
-        // Si no hay mas nodos alcanzables, terminar
-        if (actual.fila == -1) break;
-        
-        int i = actual.fila;
-        int j = actual.columna;
-        visitado[i][j] = true;
-        
-        // Si encontramos la misma base y no es el origen
-        if (grafo.matriz[i][j].base == base_buscada && !(actual == origen)) {
-            if (distancia[i][j] > mayor_distancia) {
-                mayor_distancia = distancia[i][j];
-                mejor_remota = Posicion(i, j);
-            }
+    }
+    return mejor_remota;
+}
+
+// Ruta mas corta entre dos posiciones; los landmarks solo aceleran la busqueda y el costo es el mismo
+void dijkstra(const GrafoSecuencia& grafo, Posicion origen, Posicion destino, MemoriaBusqueda& memoria,
+              ResultadoRuta& resultado, const LandmarksRuta* alt, bool exacto) {
+    // Validar posiciones
+    if (!posicion_valida(grafo, origen.fila, origen.columna) ||
+        !posicion_valida(grafo, destino.fila, destino.columna)) {
+        resultado = ResultadoRuta();
+        return;
+    }
+
+    int idx_origen = grafo.nodo(origen.fila, origen.columna);
+    int idx_destino = grafo.nodo(destino.fila, destino.columna);
+    if (exacto) {
+        PesosEnteros pesos = calcular_pesos_enteros(grafo);
+        buscar_caminos_exactos(grafo, idx_origen, idx_destino, pesos, memoria);
+        reconstruir_ruta_exacta(grafo, idx_origen, idx_destino, pesos, memoria, resultado);
+        return;
+    }
+    buscar_caminos(grafo, idx_origen, idx_destino, alt, memoria);
+    reconstruir_ruta(grafo, idx_origen, idx_destino, memoria.distancia, INFINITO, memoria, resultado);
+}
+
+void distancias_desde(const GrafoSecuencia& grafo, Posicion origen, vector<double>& distancia) {
+    MemoriaBusqueda memoria;
+    buscar_caminos(grafo, grafo.nodo(origen.fila, origen.columna), -1, nullptr, memoria);
+    distancia.resize(grafo.total);
+    for (int idx = 0; idx < grafo.total; idx++) {
+        distancia[idx] = memoria.distancia[grafo.nodo(idx / grafo.columnas, idx % grafo.columnas)];
+    }
+}
+
+// Encontrar la base remota (misma letra, mas lejana). Si 'ruta' no es nulo tambien devuelve el camino
+// hacia ella, que ya esta en el arbol de caminos minimos calculado para encontrarla
+Posicion encontrar_base_remota(const GrafoSecuencia& grafo, Posicion origen, MemoriaBusqueda& memoria,
+                               ResultadoRuta* ruta, bool exacto) {
+    int idx_origen = grafo.nodo(origen.fila, origen.columna);
+    int mejor_remota;
+
+    // Calcular distancias desde el origen a todos los nodos
+    if (exacto) {
+        PesosEnteros pesos = calcular_pesos_enteros(grafo);
+        buscar_caminos_exactos(grafo, idx_origen, -1, pesos, memoria);
+        mejor_remota = elegir_remota(grafo, idx_origen, memoria.distancia_entera, INFINITO_ENTERO);
+        if (mejor_remota != -1 && ruta != nullptr) {
+            reconstruir_ruta_exacta(grafo, idx_origen, mejor_remota, pesos, memoria, *ruta);
         }
-        
-        // Explorar vecinos
-        const NodoGrafo& nodo = grafo.matriz[i][j];
-        for (const Arista& arista : nodo.vecinos) {
-            int vi = arista.destino.fila;
-            int vj = arista.destino.columna;
-            
-            if (visitado[vi][vj]) continue;
-            
-            double nueva_distancia = distancia[i][j] + arista.peso;
-            
-            if (nueva_distancia < distancia[vi][vj]) {
-                distancia[vi][vj] = nueva_distancia;
-            }
+    } else {
+        buscar_caminos(grafo, idx_origen, -1, nullptr, memoria);
+        mejor_remota = elegir_remota(grafo, idx_origen, memoria.distancia, INFINITO);
+        if (mejor_remota != -1 && ruta != nullptr) {
+            reconstruir_ruta(grafo, idx_origen, mejor_remota, memoria.distancia, INFINITO, memoria, *ruta);
         }
     }
-    
-    return mejor_remota;
+
+    if (mejor_remota == -1) return Posicion(-1, -1);
+    return grafo.posicion(mejor_remota);
+}
+
+// Costo de la ruta; en modo exacto tambien como fraccion entera (reducida si los pesos son exactos)
+static void imprimir_costo(const ResultadoRuta& resultado) {
+    salida() << ".\nEl costo total de la ruta es: " << resultado.costo_total;
+    if (resultado.denominador != 0) {
+        uint64_t numerador = resultado.costo_entero;
+        uint64_t denominador = resultado.denominador;
+        if (resultado.costo_exacto) {
+            uint64_t comun = mcd(numerador, denominador);
+            numerador /= comun;
+            denominador /= comun;
+        }
+        salida() << " (" << numerador << "/" << denominador << (resultado.costo_exacto ? "" : " en punto fijo") << ")";
+    }
+    salida() << ".\n";
 }
 
 // Comando: ruta_mas_corta
-void ruta_mas_corta(string descripcion, string i_str, string j_str, string x_str, string y_str) {
+void ruta_mas_corta(const string& descripcion, const string& i_str, const string& j_str, const string& x_str,
+                    const string& y_str, bool exacto) {
     // Verificar que hay secuencias cargadas
-    if (secuencias.empty()) {
-        cout << "No hay secuencias cargadas en memoria.\n";
+    Instantanea version = instantanea();
+    if (version->secuencias.empty()) {
+        salida() << "No hay secuencias cargadas en memoria.\n";
         return;
     }
     
     // Buscar la secuencia
-    int indice = -1;
-    for (int idx = 0; idx < secuencias.size(); idx++) {
-        if (secuencias[idx].descripcion == descripcion) {
-            indice = idx;
-            break;
-        }
-    }
+    int indice = version->buscar(descripcion);
     
     if (indice == -1) {
-        cout << "La secuencia " << descripcion << " no existe.\n";
+        salida() << "La secuencia " << descripcion << " no existe.\n";
         return;
     }
+    const Secuencia& sec = version->secuencias[indice];
+    Bases bases = bases_de(sec);
     
     // Convertir strings a enteros
     int i, j, x, y;
@@ -278,89 +491,76 @@ void ruta_mas_corta(string descripcion, string i_str, string j_str, string x_str
         x = stoi(x_str);
         y = stoi(y_str);
     } catch (...) {
-        cout << "Error: Las posiciones deben ser numeros enteros.\n";
+        salida() << "Error: Las posiciones deben ser numeros enteros.\n";
         return;
     }
     
-    // Construir el grafo de la secuencia
-    GrafoSecuencia grafo = construir_grafo(secuencias[indice].bases, secuencias[indice].ancho_linea);
+    // Grafo de la secuencia; se conserva en la sesion para las siguientes consultas sobre las mismas bases
+    const GrafoSecuencia& grafo = grafo_sesion(bases, sec.ancho_linea);
     
     // Validar posicion de origen
     if (!posicion_valida(grafo, i, j)) {
-        cout << "La base en la posicion [" << i << "," << j << "] no existe.\n";
-        return;
-    }
-    
-    // Verificar que la posicion de origen tenga una base valida
-    int idx_origen = i * grafo.columnas + j;
-    if (idx_origen >= secuencias[indice].bases.size()) {
-        cout << "La base en la posicion [" << i << "," << j << "] no existe.\n";
+        salida() << "La base en la posicion [" << i << "," << j << "] no existe.\n";
         return;
     }
     
     // Validar posicion de destino
     if (!posicion_valida(grafo, x, y)) {
-        cout << "La base en la posicion [" << x << "," << y << "] no existe.\n";
-        return;
-    }
-    
-    // Verificar que la posicion de destino tenga una base valida
-    int idx_destino = x * grafo.columnas + y;
-    if (idx_destino >= secuencias[indice].bases.size()) {
-        cout << "La base en la posicion [" << x << "," << y << "] no existe.\n";
+        salida() << "La base en la posicion [" << x << "," << y << "] no existe.\n";
         return;
     }
     
-    // Calcular la ruta mas corta
-    ResultadoRuta resultado = dijkstra(grafo, Posicion(i, j), Posicion(x, y));
+    // Calcular la ruta mas corta; si la secuencia se preproceso con preprocesar_rutas se usan sus landmarks
+    // (el modo exacto recorre con la cola de claves enteras, que no admite las cotas ALT)
+    shared_ptr<const LandmarksRuta> alt = exacto ? nullptr : landmarks_de(descripcion, bases, grafo);
+    MemoriaSesion& memoria = memoria_sesion();
+    ResultadoRuta& resultado = memoria.ruta;
+    dijkstra(grafo, Posicion(i, j), Posicion(x, y), memoria.busqueda, resultado, alt.get(), exacto);
     
     if (!resultado.existe) {
-        cout << "No existe una ruta entre [" << i << "," << j << "] y [" << x << "," << y << "].\n";
+        salida() << "No existe una ruta entre [" << i << "," << j << "] y [" << x << "," << y << "].\n";
         return;
     }
     
     // Imprimir resultado
-    char base_origen = grafo.matriz[i][j].base;
-    char base_destino = grafo.matriz[x][y].base;
+    char base_origen = grafo.base(grafo.nodo(i, j));
+    char base_destino = grafo.base(grafo.nodo(x, y));
     
-    cout << "Para la secuencia " << descripcion 
+    salida() << "Para la secuencia " << descripcion 
          << ", la ruta mas corta entre la base " << base_origen 
          << " en [" << i << "," << j << "] y la base " << base_destino 
          << " en [" << x << "," << y << "] es: \n";
     
     // Imprimir la ruta
     for (int idx = 0; idx < resultado.camino.size(); idx++) {
-        cout << resultado.bases[idx] << "[" << resultado.camino[idx].fila 
+        salida() << resultado.bases[idx] << "[" << resultado.camino[idx].fila 
              << "," << resultado.camino[idx].columna << "]";
         if (idx < resultado.camino.size() - 1) {
-            cout << " -> ";
+            salida() << " -> ";
         }
     }
     
-    cout << ".\nEl costo total de la ruta es: " << resultado.costo_total << ".\n";
+    imprimir_costo(resultado);
 }
 
 // Comando: base_remota
-void base_remota(string descripcion, string i_str, string j_str) {
+void base_remota(const string& descripcion, const string& i_str, const string& j_str, bool exacto) {
     // Verificar que hay secuencias cargadas
-    if (secuencias.empty()) {
-        cout << "No hay secuencias cargadas en memoria.\n";
+    Instantanea version = instantanea();
+    if (version->secuencias.empty()) {
+        salida() << "No hay secuencias cargadas en memoria.\n";
         return;
     }
     
     // Buscar la secuencia
-    int indice = -1;
-    for (int idx = 0; idx < secuencias.size(); idx++) {
-        if (secuencias[idx].descripcion == descripcion) {
-            indice = idx;
-            break;
-        }
-    }
+    int indice = version->buscar(descripcion);
     
     if (indice == -1) {
-        cout << "La secuencia " << descripcion << " no existe.\n";
+        salida() << "La secuencia " << descripcion << " no existe.\n";
         return;
     }
+    const Secuencia& sec = version->secuencias[indice];
+    Bases bases = bases_de(sec);
     
     // Convertir strings a enteros
     int i, j;
@@ -368,57 +568,235 @@ void base_remota(string descripcion, string i_str, string j_str) {
         i = stoi(i_str);
         j = stoi(j_str);
     } catch (...) {
-        cout << "Error: Las posiciones deben ser numeros enteros.\n";
+        salida() << "Error: Las posiciones deben ser numeros enteros.\n";
         return;
     }
     
-    // Construir el grafo de la secuencia
-    GrafoSecuencia grafo = construir_grafo(secuencias[indice].bases, secuencias[indice].ancho_linea);
+    // Grafo de la secuencia; se conserva en la sesion para las siguientes consultas sobre las mismas bases
+    const GrafoSecuencia& grafo = grafo_sesion(bases, sec.ancho_linea);
     
     // Validar posicion
     if (!posicion_valida(grafo, i, j)) {
-        cout << "La base en la posicion [" << i << "," << j << "] no existe.\n";
+        salida() << "La base en la posicion [" << i << "," << j << "] no existe.\n";
         return;
     }
     
-    // Verificar que la posicion tenga una base valida
-    int idx_pos = i * grafo.columnas + j;
-    if (idx_pos >= secuencias[indice].bases.size()) {
-        cout << "La base en la posicion [" << i << "," << j << "] no existe.\n";
-        return;
-    }
-    
-    // Encontrar la base remota
-    Posicion remota = encontrar_base_remota(grafo, Posicion(i, j));
+    // Encontrar la base remota y la ruta hacia ella
+    MemoriaSesion& memoria = memoria_sesion();
+    ResultadoRuta& resultado = memoria.ruta;
+    Posicion remota = encontrar_base_remota(grafo, Posicion(i, j), memoria.busqueda, &resultado, exacto);
     
     if (remota.fila == -1 || remota.columna == -1) {
-        cout << "No se encontro otra base " << grafo.matriz[i][j].base 
+        salida() << "No se encontro otra base " << grafo.base(grafo.nodo(i, j))
              << " en la secuencia " << descripcion << ".\n";
         return;
     }
     
-    // Calcular la ruta hacia la base remota
-    ResultadoRuta resultado = dijkstra(grafo, Posicion(i, j), remota);
-    
     if (!resultado.existe) {
-        cout << "No existe una ruta hacia la base remota.\n";
+        salida() << "No existe una ruta hacia la base remota.\n";
         return;
     }
     
     // Imprimir resultado
-    cout << "Para la secuencia " << descripcion 
+    salida() << "Para la secuencia " << descripcion 
          << ", la base remota esta ubicada en [" << remota.fila << "," << remota.columna 
          << "], y la ruta entre la base en [" << i << "," << j 
          << "] y la base remota en [" << remota.fila << "," << remota.columna << "] es: \n";
     
     // Imprimir la ruta
     for (int idx = 0; idx < resultado.camino.size(); idx++) {
-        cout << resultado.bases[idx] << "[" << resultado.camino[idx].fila 
+        salida() << resultado.bases[idx] << "[" << resultado.camino[idx].fila 
              << "," << resultado.camino[idx].columna << "]";
         if (idx < resultado.camino.size() - 1) {
-            cout << " -> ";
+            salida() << " -> ";
         }
     }
     
-    cout << ".\nEl costo total de la ruta es: " << resultado.costo_total << ".\n";
+    imprimir_costo(resultado);
+}
+
+// Formato del archivo de base_remota_todas (enteros en little-endian):
+//   magia (4 bytes), version (1 byte), filas y columnas (4 bytes c/u), total de bases (8 bytes),
+//   huella de las bases (8 bytes) y un registro por posicion en orden fila-mayor: indice fila-mayor de
+//   su base remota (4 bytes, 0xFFFFFFFF si no hay) y distancia (8 bytes, bits del double)
+const uint32_t MAGIA_REMOTAS = 0x31545242; // "BRT1"
+const uint8_t VERSION_REMOTAS = 1;
+const uint64_t TAM_CABECERA_REMOTAS = 29;
+const uint64_t TAM_REGISTRO_REMOTA = 12;
+const uint32_t SIN_REMOTA = 0xFFFFFFFF;
+const int ORIGENES_POR_BLOQUE = 256; // Unidad de reparto entre hilos y de escritura
+const int SEGUNDOS_ENTRE_SINCRONIZACIONES = 5; // Punto de control: un fdatasync por bloque serian miles en una grilla grande
+
+// Estado compartido por los hilos de base_remota_todas. Los bloques terminan en cualquier orden;
+// se escriben en orden y el archivo queda siempre con un prefijo de posiciones completo, que es
+// desde donde una ejecucion interrumpida retoma
+struct EstadoRemotas {
+    const GrafoSecuencia* grafo;
+    uint64_t total;
+    atomic<uint64_t> siguiente;              // Primer origen del proximo bloque por repartir
+    atomic<bool> error;
+
+    mutex candado;
+    EscritorBinario* archivo;
+    uint64_t escritos;                       // Posiciones ya escritas en el archivo
+    map<uint64_t, vector<uint8_t>> listos;   // Bloques terminados que esperan a los anteriores
+    chrono::steady_clock::time_point ultima_sincronizacion;
+};
+
+static void escribir_registro_remota(uint8_t* destino, int remota, double distancia) {
+    uint32_t indice = remota == -1 ? SIN_REMOTA : (uint32_t)remota;
+    uint64_t bits;
+    memcpy(&bits, &distancia, sizeof(bits));
+    for (int b = 0; b < 4; b++) destino[b] = (indice >> (8 * b)) & 0xff;
+    for (int b = 0; b < 8; b++) destino[4 + b] = (bits >> (8 * b)) & 0xff;
+}
+
+static void hilo_remotas(EstadoRemotas& estado) {
+    MemoriaBusqueda memoria; // Se reutiliza en todas las busquedas del hilo
+    vector<uint8_t> registros;
+    while (!estado.error) {
+        uint64_t inicio = estado.siguiente.fetch_add(ORIGENES_POR_BLOQUE);
+        if (inicio >= estado.total) return;
+        uint64_t fin = min(estado.total, inicio + ORIGENES_POR_BLOQUE);
+
+        registros.resize((fin - inicio) * TAM_REGISTRO_REMOTA);
+        const GrafoSecuencia& grafo = *estado.grafo;
+        for (uint64_t idx = inicio; idx < fin; idx++) {
+            int origen = grafo.nodo(idx / grafo.columnas, idx % grafo.columnas);
+            buscar_caminos(grafo, origen, -1, nullptr, memoria);
+            int remota = elegir_remota(grafo, origen, memoria.distancia, INFINITO);
+            escribir_registro_remota(&registros[(idx - inicio) * TAM_REGISTRO_REMOTA], remota == -1 ? -1 : grafo.orden(remota),
+                                     remota == -1 ? 0.0 : memoria.distancia[remota]);
+        }
+
+        lock_guard<mutex> bloqueo(estado.candado);
+        estado.listos[inicio].swap(registros);
+        bool escribio = false;
+        while (!estado.listos.empty() && estado.listos.begin()->first == estado.escritos) {
+            vector<uint8_t>& bloque = estado.listos.begin()->second;
+            estado.archivo->escribir_bytes(bloque.data(), bloque.size());
+            estado.escritos += bloque.size() / TAM_REGISTRO_REMOTA;
+            estado.listos.erase(estado.listos.begin());
+            escribio = true;
+        }
+        // Un registro a medio escribir al interrumpirse se descarta al retomar, asi que basta con
+        // sincronizar cada tanto; al terminar se sincroniza el resto
+        chrono::steady_clock::time_point ahora = chrono::steady_clock::now();
+        if (escribio && ahora - estado.ultima_sincronizacion >= chrono::seconds(SEGUNDOS_ENTRE_SINCRONIZACIONES)) {
+            if (!estado.archivo->sincronizar()) estado.error = true;
+            estado.ultima_sincronizacion = ahora;
+        }
+    }
+}
+
+// Posiciones ya resueltas en un archivo de una ejecucion anterior para las mismas bases,
+// 0 si el archivo no existe o es de otra secuencia, o -1 si existe y no es de base_remota_todas
+static int64_t remotas_previas(const string& nombreArchivo, const GrafoSecuencia& grafo, uint64_t total, uint64_t huella) {
+    LectorBinario archivo;
+    if (!archivo.abrir(nombreArchivo) || archivo.restantes() == 0) {
+        return 0;
+    }
+    uint32_t magia, filas, columnas;
+    uint8_t version;
+    uint64_t total_archivo, huella_archivo;
+    if (!archivo.leer_u32(magia) || magia != MAGIA_REMOTAS) {
+        return -1;
+    }
+    if (!archivo.leer_u8(version) || version != VERSION_REMOTAS || !archivo.leer_u32(filas) ||
+        !archivo.leer_u32(columnas) || !archivo.leer_u64(total_archivo) || !archivo.leer_u64(huella_archivo) ||
+        (int)filas != grafo.filas || (int)columnas != grafo.columnas || total_archivo != total || huella_archivo != huella) {
+        return 0;
+    }
+    return min(total, archivo.restantes() / TAM_REGISTRO_REMOTA);
+}
+
+// Comando: base_remota_todas
+void base_remota_todas(string descripcion, string nombreArchivo, string hilos_str) {
+    // Verificar que hay secuencias cargadas
+    Instantanea version = instantanea();
+    if (version->secuencias.empty()) {
+        salida() << "No hay secuencias cargadas en memoria.\n";
+        return;
+    }
+
+    // Buscar la secuencia
+    int indice = version->buscar(descripcion);
+    if (indice == -1) {
+        salida() << "La secuencia " << descripcion << " no existe.\n";
+        return;
+    }
+    const Secuencia& sec = version->secuencias[indice];
+    Bases bases = bases_de(sec);
+
+    int num_hilos = thread::hardware_concurrency();
+    if (num_hilos < 1) num_hilos = 1;
+    if (!hilos_str.empty()) {
+        try {
+            num_hilos = stoi(hilos_str);
+        } catch (...) {
+            num_hilos = 0;
+        }
+        if (num_hilos < 1 || num_hilos > 256) {
+            salida() << "Error: La cantidad de hilos debe estar entre 1 y 256.\n";
+            return;
+        }
+    }
+
+    GrafoSecuencia grafo = construir_grafo(bases->texto, sec.ancho_linea);
+    uint64_t total = bases->texto.size();
+    uint64_t huella = huella_bases(bases->texto, sec.ancho_linea);
+
+    // Retomar lo que haya dejado una ejecucion anterior para las mismas bases
+    int64_t previas = remotas_previas(nombreArchivo, grafo, total, huella);
+    if (previas < 0) {
+        salida() << "Error: " << nombreArchivo << " ya existe y no es un archivo de base_remota_todas.\n";
+        return;
+    }
+
+    EscritorBinario archivo;
+    bool abierto;
+    if (previas > 0) {
+        abierto = archivo.abrir_al_final(nombreArchivo, TAM_CABECERA_REMOTAS + previas * TAM_REGISTRO_REMOTA);
+    } else {
+        abierto = archivo.abrir(nombreArchivo);
+        archivo.escribir_u32(MAGIA_REMOTAS);
+        archivo.escribir_u8(VERSION_REMOTAS);
+        archivo.escribir_u32(grafo.filas);
+        archivo.escribir_u32(grafo.columnas);
+        archivo.escribir_u64(total);
+        archivo.escribir_u64(huella);
+    }
+    if (!abierto) {
+        salida() << "No se puede escribir en " << nombreArchivo << ".\n";
+        return;
+    }
+
+    EstadoRemotas estado;
+    estado.grafo = &grafo;
+    estado.total = total;
+    estado.siguiente = previas;
+    estado.error = false;
+    estado.archivo = &archivo;
+    estado.escritos = previas;
+    estado.ultima_sincronizacion = chrono::steady_clock::now();
+
+    vector<thread> hilos;
+    for (int t = 0; t < num_hilos; t++) {
+        hilos.push_back(thread(hilo_remotas, ref(estado)));
+    }
+    for (size_t t = 0; t < hilos.size(); t++) {
+        hilos[t].join();
+    }
+
+    archivo.sincronizar(); // Un error queda registrado y cerrar lo informa
+    if (!archivo.cerrar() || estado.error) {
+        salida() << "Error al escribir " << nombreArchivo << "; quedaron " << estado.escritos
+                 << " posiciones y se puede retomar con el mismo comando.\n";
+        return;
+    }
+    salida() << "Se calcularon las bases remotas de las " << total << " posiciones de la secuencia " << descripcion;
+    if (previas > 0) {
+        salida() << " (" << previas << " retomadas de una ejecucion anterior)";
+    }
+    salida() << " y se guardaron en " << nombreArchivo << ".\n";
 }
@@ -3,6 +3,7 @@
 
 #include <string>
 #include <vector>
+#include <cstdint>
 
 using namespace std;
 
@@ -19,31 +20,60 @@ struct Posicion {
     }
 };
 
-// Estructura para representar una arista con su peso
-struct Arista {
-    Posicion destino;
-    double peso;
-    
-    Arista(Posicion dest, double p) : destino(dest), peso(p) {}
-};
-
-// Estructura para representar un nodo del grafo
-struct NodoGrafo {
-    char base;                    // Base nitrogenada en esta posicion
-    Posicion posicion;            // Posición [i,j] en la matriz
-    vector<Arista> vecinos;       // Lista de vecinos con sus pesos
-    
-    NodoGrafo() : base('\0'), posicion() {}
-    NodoGrafo(char b, int i, int j) : base(b), posicion(i, j) {}
-};
+// Direcciones de los vecinos de un nodo. Estan en el orden fila-mayor de los vecinos (el de arriba
+// tiene el menor indice y el de abajo el mayor) y la opuesta de d es 3 - d
+enum DireccionVecino { VECINO_ARRIBA = 0, VECINO_IZQUIERDA = 1, VECINO_DERECHA = 2, VECINO_ABAJO = 3 };
 
-// Estructura para representar el grafo completo de una secuencia
+// Estructura para representar el grafo completo de una secuencia, como arreglos paralelos en una sola
+// reserva: la base de cada nodo y una mascara de 4 bits con los vecinos que existen (bit d = direccion d).
+// Los nodos se guardan por bloques de hasta 8x8 posiciones (cada bloque contiguo, fila-mayor por dentro
+// y los bloques tambien en orden fila-mayor), asi que los vecinos de arriba y abajo suelen estar en la
+// misma zona de memoria que el nodo. El relleno de los bloques del borde no tiene base ni vecinos.
+// Los pesos no se guardan: salen de una tabla indexada por la diferencia entre las dos bases
 struct GrafoSecuencia {
-    vector<vector<NodoGrafo>> matriz;  // Matriz de nodos [fila][columna]
     int filas;
-    int columnas; // Teniendo en cuenta el ancho de linea del archivo fasta
-    
-    GrafoSecuencia() : filas(0), columnas(0) {}
+    int columnas;                 // Teniendo en cuenta el ancho de linea del archivo fasta
+    int total;                    // Cantidad de bases
+    int tam;                      // Cantidad de nodos, contando el relleno de los bloques
+    int bits_ancho;               // Log2 del ancho de un bloque
+    int bits_alto;                // Log2 del alto de un bloque
+    int bloques_por_fila;
+    int paso[4];                  // Diferencia del indice fila-mayor hacia cada direccion
+    vector<uint8_t> datos;        // tam bases seguidas de tam mascaras de vecinos
+
+    GrafoSecuencia() : filas(0), columnas(0), total(0), tam(0), bits_ancho(0), bits_alto(0), bloques_por_fila(0) {}
+
+    char base(int nodo) const { return datos[nodo]; }
+    uint8_t vecinos(int nodo) const { return datos[tam + nodo]; }
+
+    int nodo(int fila, int columna) const {
+        int bloque = (fila >> bits_alto) * bloques_por_fila + (columna >> bits_ancho);
+        return (bloque << (bits_ancho + bits_alto)) | ((fila & ((1 << bits_alto) - 1)) << bits_ancho) |
+               (columna & ((1 << bits_ancho) - 1));
+    }
+    Posicion posicion(int nodo) const {
+        int bloque = nodo >> (bits_ancho + bits_alto);
+        return Posicion((bloque / bloques_por_fila) << bits_alto | ((nodo >> bits_ancho) & ((1 << bits_alto) - 1)),
+                        (bloque % bloques_por_fila) << bits_ancho | (nodo & ((1 << bits_ancho) - 1)));
+    }
+    int orden(int nodo) const { // Indice fila-mayor (desplazamiento en la secuencia)
+        Posicion pos = posicion(nodo);
+        return pos.fila * columnas + pos.columna;
+    }
+
+    // Vecino en la direccion d; solo es valido si el bit d de vecinos(nodo) esta encendido
+    int vecino(int nodo, int d) const {
+        int ancho = 1 << bits_ancho;
+        int columna = nodo & (ancho - 1);
+        int fila = (nodo >> bits_ancho) & ((1 << bits_alto) - 1);
+        int bloque = 1 << (bits_ancho + bits_alto);
+        switch (d) {
+            case VECINO_ARRIBA:    return fila > 0 ? nodo - ancho : nodo - bloques_por_fila * bloque + (bloque - ancho);
+            case VECINO_IZQUIERDA: return columna > 0 ? nodo - 1 : nodo - bloque + (ancho - 1);
+            case VECINO_DERECHA:   return columna < ancho - 1 ? nodo + 1 : nodo + bloque - (ancho - 1);
+            default:               return fila < (1 << bits_alto) - 1 ? nodo + ancho : nodo + bloques_por_fila * bloque - (bloque - ancho);
+        }
+    }
 };
 
 // Estructura para representar el resultado de una ruta
@@ -52,19 +82,65 @@ struct ResultadoRuta {
     vector<char> bases;           // Bases en cada posicion de la ruta
     double costo_total;           // Costo total de la ruta
     bool existe;                  // Si se encontro una ruta valida
+
+    // Solo en modo exacto: costo = costo_entero / denominador (denominador 0 en punto flotante)
+    uint64_t costo_entero;
+    uint64_t denominador;
+    bool costo_exacto;            // false si los pesos enteros se redondearon a punto fijo
     
-    ResultadoRuta() : costo_total(0.0), existe(false) {}
+    ResultadoRuta() : costo_total(0.0), existe(false), costo_entero(0), denominador(0), costo_exacto(false) {}
 };
 
+// Entrada de la cola de prioridad. A igual clave sale primero el nodo de menor indice fila-mayor,
+// el mismo orden en que la antigua busqueda lineal asentaba los empates
+struct EntradaCola {
+    double clave;
+    int orden;  // Indice fila-mayor del nodo
+    int nodo;
+
+    EntradaCola(double c, int o, int n) : clave(c), orden(o), nodo(n) {}
+    bool operator>(const EntradaCola& otra) const {
+        return clave > otra.clave || (clave == otra.clave && orden > otra.orden);
+    }
+};
+
+// Memoria de trabajo de una busqueda. Quien hace muchas busquedas seguidas (base_remota_todas, o una
+// sesion que repite consultas) conserva la misma y cada busqueda solo la reinicia, sin volver a reservarla.
+// Por nodo son 8 bytes de distancia y 2 bits de predecesor
+struct MemoriaBusqueda {
+    vector<double> distancia;
+    vector<uint64_t> distancia_entera;       // Modo exacto
+    vector<uint8_t> predecesor;
+    vector<EntradaCola> cola;                // Monticulo binario (push_heap/pop_heap con greater)
+    vector<pair<uint64_t, int>> cubetas[65]; // Cola radix del modo exacto
+    vector<int> camino;                      // Ruta reconstruida, del destino al origen
+
+    size_t bytes_reservados() const;
+};
+
+struct LandmarksRuta; // Cotas ALT de preprocesar_rutas (landmarks.h)
+
 // Funciones principales
-void ruta_mas_corta(string descripcion, string i_str, string j_str, string x_str, string y_str);
-void base_remota(string descripcion, string i_str, string j_str);
+// Con 'exacto' los pesos se escalan a enteros y las distancias se suman sin redondeo (ver calcular_pesos_enteros)
+// Las consultas reciben los argumentos por referencia y trabajan sobre la memoria de la sesion (sesion.h)
+void ruta_mas_corta(const string& descripcion, const string& i_str, const string& j_str, const string& x_str,
+                    const string& y_str, bool exacto = false);
+void base_remota(const string& descripcion, const string& i_str, const string& j_str, bool exacto = false);
+// Base remota y su distancia para cada posicion, en paralelo; escribe una matriz binaria de registros
+// y, si se interrumpe, una nueva ejecucion con el mismo archivo retoma desde la ultima posicion escrita
+void base_remota_todas(string descripcion, string nombreArchivo, string hilos_str = "");
 
 // Funciones auxiliares
 GrafoSecuencia construir_grafo(const string& secuencia_bases, int ancho_linea);
+void construir_grafo(const string& secuencia_bases, int ancho_linea, GrafoSecuencia& grafo); // Reutiliza grafo.datos
 double calcular_peso_arista(char base1, char base2);
-ResultadoRuta dijkstra(const GrafoSecuencia& grafo, Posicion origen, Posicion destino); // Algoritmo de Dijkstra, utilizado para ambas funciones
-bool posicion_valida(const GrafoSecuencia& grafo, int i, int j);
-Posicion encontrar_base_remota(const GrafoSecuencia& grafo, Posicion origen);
+// Algoritmo de Dijkstra con cola de prioridad; con landmarks se convierte en A* con cotas ALT.
+// La ruta se escribe en 'resultado', que igual que 'memoria' conserva sus reservas entre llamadas
+void dijkstra(const GrafoSecuencia& grafo, Posicion origen, Posicion destino, MemoriaBusqueda& memoria,
+              ResultadoRuta& resultado, const LandmarksRuta* alt = nullptr, bool exacto = false);
+void distancias_desde(const GrafoSecuencia& grafo, Posicion origen, vector<double>& distancia); // Indexadas fila-mayor
+bool posicion_valida(const GrafoSecuencia& grafo, int i, int j); // Dentro de la matriz y con base
+Posicion encontrar_base_remota(const GrafoSecuencia& grafo, Posicion origen, MemoriaBusqueda& memoria,
+                               ResultadoRuta* ruta = nullptr, bool exacto = false);
 
 #endif
@@ -1,368 +1,1316 @@
 #include "huffman.h"
 #include "secuencias.h"
+#include "binario.h"
+#include "perfil.h"
+#include "interfaz.h"
+#include "crc32c.h"
 #include <iostream>
-#include <fstream>
 #include <algorithm>
 #include <cstdint>
 #include <vector>
+#include <thread>
+#include <atomic>
+#include <unordered_map>
+#include <cstring>
 
 using namespace std;
 
 const int MAX_SIMBOLOS = 256; // Funciona tanto con las bases nitrogenadas como con cualquier otro caracter ASCII
 
-// Comparador para min-heap 
+// Comparador para min-heap sobre indices del arreglo de nodos
 struct CompararNodos {
-    bool operator()(NodoHuffman* a, NodoHuffman* b) const {
-        return a->frecuencia > b->frecuencia; // Invertir para min-heap
+    const vector<NodoHuffman>* nodos;
+
+    CompararNodos(const vector<NodoHuffman>& n) : nodos(&n) {}
+
+    bool operator()(int32_t a, int32_t b) const {
+        return (*nodos)[a].frecuencia > (*nodos)[b].frecuencia; // Invertir para min-heap
     }
 };
 
-// Función para liberar memoria del árbol de Huffman
-void liberar_arbol(NodoHuffman* nodo) {
-    if (nodo == nullptr) return;
-    liberar_arbol(nodo->izquierdo);
-    liberar_arbol(nodo->derecho);
-    delete nodo;
+// Orden de las hojas para la construccion con dos colas: frecuencia ascendente, desempate por simbolo
+struct CompararHojas {
+    const vector<NodoHuffman>* nodos;
+
+    CompararHojas(const vector<NodoHuffman>& n) : nodos(&n) {}
+
+    bool operator()(int32_t a, int32_t b) const {
+        const NodoHuffman& x = (*nodos)[a];
+        const NodoHuffman& y = (*nodos)[b];
+        if (x.frecuencia != y.frecuencia) return x.frecuencia < y.frecuencia;
+        return (unsigned char)x.simbolo < (unsigned char)y.simbolo;
+    }
+};
+
+// Agrega un nodo interno con los dos hijos dados y devuelve su indice
+static int32_t agregar_interno(ArbolHuffman& arbol, int32_t izq, int32_t der) {
+    uint64_t frecuencia = arbol.nodos[izq].frecuencia + (der == -1 ? 0 : arbol.nodos[der].frecuencia);
+    arbol.nodos.push_back(NodoHuffman('\0', frecuencia));
+    arbol.nodos.back().izquierdo = izq;
+    arbol.nodos.back().derecho = der;
+    return arbol.nodos.size() - 1;
 }
 
-// Hace el arbol de huffman iniciando desde las hojas, dado el min heap
-NodoHuffman* construir_arbol_huffman(FrecuenciaSimbolo* frecuencias, int num_simbolos) {
-    // Crear vector para el heap
-    vector<NodoHuffman*> heap;
+// Inserta las hojas en el arreglo; devuelve false si no hay simbolos
+static bool iniciar_hojas(FrecuenciaSimbolo* frecuencias, int num_simbolos, ArbolHuffman& arbol) {
+    arbol.nodos.clear(); // Conserva la capacidad si el arbol se reutiliza
+    arbol.nodos.reserve(2 * num_simbolos);
+    arbol.raiz = -1;
     
     // Insertar todos los símbolos como nodos hoja
     for (int i = 0; i < num_simbolos; i++) {
-        heap.push_back(new NodoHuffman(frecuencias[i].simbolo, frecuencias[i].frecuencia));
+        arbol.nodos.push_back(NodoHuffman(frecuencias[i].simbolo, frecuencias[i].frecuencia));
     }
     
-    // Convertir el vector en un min-heap
-    make_heap(heap.begin(), heap.end(), CompararNodos());
+    // En el caso de que solo haya un simbolo la raiz tiene unicamente hijo izquierdo
+    if (num_simbolos == 1) {
+        arbol.raiz = agregar_interno(arbol, 0, -1);
+    }
+    return num_simbolos > 0;
+}
+
+// Hace el arbol de huffman iniciando desde las hojas con el metodo de dos colas:
+// las hojas ordenadas por frecuencia forman la primera cola y los nodos internos, que se crean
+// con frecuencias no decrecientes, forman la segunda. Cada paso toma los dos menores de los frentes
+void construir_arbol_huffman(FrecuenciaSimbolo* frecuencias, int num_simbolos, ArbolHuffman& arbol) {
+    if (!iniciar_hojas(frecuencias, num_simbolos, arbol) || arbol.raiz != -1) return;
     
-    // En el caso de que solo haya un simbolo
-    if (heap.size() == 1) {
-        NodoHuffman* unico = heap.front();
-        NodoHuffman* raiz = new NodoHuffman('\0', unico->frecuencia);
-        raiz->izquierdo = unico;
-        return raiz;
+    // Primera cola: hojas ordenadas por frecuencia
+    int32_t hojas[MAX_SIMBOLOS];
+    for (int i = 0; i < num_simbolos; i++) {
+        hojas[i] = i;
     }
+    sort(hojas, hojas + num_simbolos, CompararHojas(arbol.nodos));
+    int frente_hojas = 0;
+    
+    // Segunda cola: los nodos internos quedan en orden de creacion a partir de num_simbolos
+    int32_t frente_internos = num_simbolos;
+    
+    // Extrae el menor de los frentes; en empate se prefiere la hoja
+    auto extraer_menor = [&]() -> int32_t {
+        bool hay_hoja = frente_hojas < num_simbolos;
+        bool hay_interno = frente_internos < (int32_t)arbol.nodos.size();
+        if (hay_hoja && (!hay_interno ||
+            arbol.nodos[hojas[frente_hojas]].frecuencia <= arbol.nodos[frente_internos].frecuencia)) {
+            return hojas[frente_hojas++];
+        }
+        return frente_internos++;
+    };
+    
+    // Construir el árbol combinando nodos: n - 1 combinaciones
+    for (int paso = 0; paso < num_simbolos - 1; paso++) {
+        int32_t izq = extraer_menor();
+        int32_t der = extraer_menor();
+        agregar_interno(arbol, izq, der);
+    }
+    
+    // El último nodo creado es la raíz del árbol
+    arbol.raiz = arbol.nodos.size() - 1;
+}
+
+// Construccion original con min-heap. Solo se usa para leer archivos .fabin sin cabecera,
+// escritos antes del metodo de dos colas, porque sus codigos dependen de este orden de desempate
+void construir_arbol_huffman_heredado(FrecuenciaSimbolo* frecuencias, int num_simbolos, ArbolHuffman& arbol) {
+    if (!iniciar_hojas(frecuencias, num_simbolos, arbol) || arbol.raiz != -1) return;
+    
+    // Convertir los indices de las hojas en un min-heap
+    vector<int32_t> heap;
+    for (int i = 0; i < num_simbolos; i++) {
+        heap.push_back(i);
+    }
+    CompararNodos comparar(arbol.nodos);
+    make_heap(heap.begin(), heap.end(), comparar);
     
-    // Construir el árbol combinando nodos
     while (heap.size() > 1) {
-        // Extraer el nodo con menor frecuencia
-        pop_heap(heap.begin(), heap.end(), CompararNodos());
-        NodoHuffman* izq = heap.back();
+        // Extraer los dos nodos con menor frecuencia
+        pop_heap(heap.begin(), heap.end(), comparar);
+        int32_t izq = heap.back();
         heap.pop_back();
-        
-        // Extraer el segundo nodo con menor frecuencia
-        pop_heap(heap.begin(), heap.end(), CompararNodos());
-        NodoHuffman* der = heap.back();
+        pop_heap(heap.begin(), heap.end(), comparar);
+        int32_t der = heap.back();
         heap.pop_back();
         
-        // Crear un nodo interno con la suma de frecuencias
-        NodoHuffman* interno = new NodoHuffman('\0', izq->frecuencia + der->frecuencia);
-        interno->izquierdo = izq;
-        interno->derecho = der;
+        // Crear un nodo interno con la suma de frecuencias e insertarlo de vuelta en el heap
+        heap.push_back(agregar_interno(arbol, izq, der));
+        push_heap(heap.begin(), heap.end(), comparar);
+    }
+    
+    arbol.raiz = heap.front();
+}
+
+// Genera la tabla de codigos de huffman con un recorrido iterativo en profundidad.
+// El camino desde la raiz se mantiene en un unico buffer en lugar de copiar strings en cada nivel
+void generar_tabla_codigos(const ArbolHuffman& arbol, CodigoHuffman* tabla, int& num_codigos) {
+    if (arbol.raiz == -1) return;
+    
+    // Cada entrada de la pila guarda el nodo, su profundidad y el bit de la arista que llega a el
+    struct Pendiente {
+        int32_t nodo;
+        int profundidad;
+        char bit;
+    };
+    Pendiente pila[MAX_SIMBOLOS * 2];
+    char camino[MAX_SIMBOLOS];
+    int tope = 0;
+    
+    pila[tope++] = {arbol.raiz, 0, '\0'};
+    
+    while (tope > 0) {
+        Pendiente actual = pila[--tope];
+        const NodoHuffman& nodo = arbol.nodos[actual.nodo];
+        
+        // Los niveles superiores del camino ya los escribieron los ancestros; solo falta el bit de este nivel
+        if (actual.profundidad > 0) {
+            camino[actual.profundidad - 1] = actual.bit;
+        }
         
-        // Insertar el nodo interno de vuelta en el heap
-        heap.push_back(interno);
-        push_heap(heap.begin(), heap.end(), CompararNodos());
+        // Si es un nodo hoja, guardar el código
+        if (nodo.es_hoja()) {
+            tabla[num_codigos].simbolo = nodo.simbolo;
+            if (actual.profundidad == 0) {
+                tabla[num_codigos].codigo = "0";
+            } else {
+                tabla[num_codigos].codigo.assign(camino, actual.profundidad);
+            }
+            num_codigos++;
+            continue;
+        }
+        
+        // Se apila primero el derecho ("1") para recorrer antes el izquierdo ("0")
+        if (nodo.derecho != -1) {
+            pila[tope++] = {nodo.derecho, actual.profundidad + 1, '1'};
+        }
+        pila[tope++] = {nodo.izquierdo, actual.profundidad + 1, '0'};
+    }
+}
+
+// Acumula bits (del mas significativo al menos significativo) y los agrega al final de 'destino' en bloques de bytes
+class EscritorBits {
+public:
+    EscritorBits(vector<uint8_t>& destino) : destino(destino), acumulador(0), num_bits(0), usados(0) {}
+
+    // Agrega los 'largo' bits menos significativos de 'bits' (largo <= 57)
+    void agregar(uint64_t bits, int largo) {
+        acumulador = (acumulador << largo) | bits;
+        num_bits += largo;
+        while (num_bits >= 8) {
+            num_bits -= 8;
+            bloque[usados++] = (uint8_t)(acumulador >> num_bits);
+            if (usados == sizeof(bloque)) {
+                destino.insert(destino.end(), bloque, bloque + usados);
+                usados = 0;
+            }
+        }
+    }
+
+    // Relleno de 0s hasta completar el ultimo byte y entrega de lo pendiente
+    void terminar() {
+        if (num_bits > 0) {
+            agregar(0, 8 - num_bits);
+        }
+        destino.insert(destino.end(), bloque, bloque + usados);
+        usados = 0;
+        acumulador = 0;
+    }
+
+private:
+    vector<uint8_t>& destino;
+    uint64_t acumulador;
+    int num_bits;
+    uint8_t bloque[1 << 16];
+    size_t usados;
+};
+
+const int MAX_BITS_DIRECTOS = 57; // Codigos mas largos se agregan bit a bit (solo con frecuencias extremas)
+const uint64_t MIN_BASES_POR_HILO = 1 << 22; // Con menos bases por hilo no compensa crear hilos para el conteo
+
+// Marca de cada secuencia (version 2): se codifica con la tabla global o con una tabla propia que la sigue.
+// Desde la version 5 una secuencia identica a otra anterior no se codifica y solo guarda su posicion
+const uint8_t TABLA_GLOBAL = 0;
+const uint8_t TABLA_PROPIA = 1;
+const uint8_t TABLA_REFERENCIA = 2;
+
+const uint64_t BLOQUE_CRC = 1 << 20; // Bytes de la secuencia codificada cubiertos por cada CRC32C (version 4)
+
+// Opciones del archivo (version 3)
+const uint8_t OPCION_RACHAS = 1; // Las rachas se codifican como marcas; el byte siguiente es el simbolo de escape
+const uint8_t OPCION_MASCARA = 2; // Cada secuencia guarda sus tramos en minuscula (mascara suave)
+
+// Marcas de racha: UMBRAL_RACHA o mas bases iguales seguidas se codifican como la base, el simbolo de
+// escape y el largo de la racha menos UMBRAL_RACHA en binario, precedido de su cantidad de bits (5 bits).
+// Las rachas mas largas que MAX_RACHA se reparten en varias marcas
+const uint64_t UMBRAL_RACHA = 32;
+const int BITS_ANCHO_RACHA = 5;
+const int MAX_BITS_RACHA = 16;
+const uint64_t MAX_RACHA = UMBRAL_RACHA + (1 << MAX_BITS_RACHA) - 1;
+
+// Reparte una racha en marcas de MAX_RACHA bases y una ultima con el resto, si alcanza el umbral;
+// si no, esas bases quedan sueltas. Devuelve la cantidad de marcas
+static uint64_t repartir_racha(uint64_t largo, uint64_t& sueltas) {
+    uint64_t marcas = largo / MAX_RACHA;
+    uint64_t resto = largo % MAX_RACHA;
+    sueltas = 0;
+    if (resto >= UMBRAL_RACHA) {
+        marcas++;
+    } else {
+        sueltas = resto;
+    }
+    return marcas;
+}
+
+// Cuenta los simbolos del tramo [inicio, fin) de la concatenacion de los textos. Se usan cuatro tablas
+// intercaladas para que una base repetida no tenga que esperar al incremento anterior del mismo contador.
+// Con 'rachas' se cuentan los simbolos tal como se codifican: cada marca aporta una vez su base y se
+// devuelve la cantidad de marcas. La racha que cruza el inicio del tramo la cuenta el tramo anterior,
+// que la sigue hasta su final, asi que la suma de todos los tramos es exacta aunque un contador
+// parcial quede "negativo" (en aritmetica modular)
+static uint64_t contar_tramo(const vector<const string*>& textos, uint64_t inicio, uint64_t fin, bool rachas,
+                             uint64_t* conteo) {
+    uint64_t tablas[4][MAX_SIMBOLOS] = {{0}};
+    uint64_t marcas = 0;
+    uint64_t desplazamiento = 0;
+    for (size_t i = 0; i < textos.size() && desplazamiento < fin; i++) {
+        uint64_t tam = textos[i]->size();
+        if (desplazamiento + tam > inicio) {
+            const unsigned char* datos = (const unsigned char*)textos[i]->data();
+            uint64_t desde = inicio > desplazamiento ? inicio - desplazamiento : 0;
+            uint64_t hasta = min(tam, fin - desplazamiento);
+            uint64_t j = desde;
+            for (; j + 4 <= hasta; j += 4) {
+                tablas[0][datos[j]]++;
+                tablas[1][datos[j + 1]]++;
+                tablas[2][datos[j + 2]]++;
+                tablas[3][datos[j + 3]]++;
+            }
+            for (; j < hasta; j++) {
+                tablas[0][datos[j]]++;
+            }
+            
+            if (rachas) {
+                j = desde;
+                while (j > 0 && j < tam && datos[j] == datos[j - 1]) {
+                    j++; // Racha iniciada en el tramo anterior
+                }
+                while (j < hasta) {
+                    uint64_t k = j + 1;
+                    while (k < tam && datos[k] == datos[j]) {
+                        k++;
+                    }
+                    if (k - j >= UMBRAL_RACHA) {
+                        uint64_t sueltas;
+                        uint64_t m = repartir_racha(k - j, sueltas);
+                        tablas[0][datos[j]] -= (k - j) - (m + sueltas);
+                        marcas += m;
+                    }
+                    j = k;
+                }
+            }
+        }
+        desplazamiento += tam;
+    }
+    for (int s = 0; s < MAX_SIMBOLOS; s++) {
+        conteo[s] = tablas[0][s] + tablas[1][s] + tablas[2][s] + tablas[3][s];
+    }
+    return marcas;
+}
+
+// Cuenta los simbolos de todos los textos: la concatenacion se reparte en tramos iguales, uno por hilo,
+// cada hilo llena sus propios 256 contadores y al final se suman. Devuelve la cantidad de marcas de racha
+static uint64_t contar_simbolos(const vector<const string*>& textos, bool rachas, uint64_t* conteo) {
+    uint64_t total = 0;
+    for (size_t i = 0; i < textos.size(); i++) {
+        total += textos[i]->size();
+    }
+    
+    int num_hilos = thread::hardware_concurrency();
+    if (num_hilos < 1) num_hilos = 1;
+    if ((uint64_t)num_hilos > total / MIN_BASES_POR_HILO) {
+        num_hilos = max<uint64_t>(1, total / MIN_BASES_POR_HILO);
     }
     
-    // El último nodo es la raíz del árbol
-    return heap.front();
+    vector<uint64_t> parciales((size_t)num_hilos * MAX_SIMBOLOS);
+    vector<uint64_t> marcas(num_hilos);
+    vector<thread> hilos;
+    for (int t = 1; t < num_hilos; t++) {
+        hilos.push_back(thread([&textos, &parciales, &marcas, total, num_hilos, rachas, t]() {
+            marcas[t] = contar_tramo(textos, total * t / num_hilos, total * (t + 1) / num_hilos, rachas,
+                                     &parciales[(size_t)t * MAX_SIMBOLOS]);
+        }));
+    }
+    marcas[0] = contar_tramo(textos, 0, total / num_hilos, rachas, &parciales[0]);
+    for (size_t t = 0; t < hilos.size(); t++) {
+        hilos[t].join();
+    }
+    
+    uint64_t total_marcas = 0;
+    for (int t = 0; t < num_hilos; t++) {
+        total_marcas += marcas[t];
+    }
+    for (int s = 0; s < MAX_SIMBOLOS; s++) {
+        conteo[s] = 0;
+        for (int t = 0; t < num_hilos; t++) {
+            conteo[s] += parciales[(size_t)t * MAX_SIMBOLOS + s];
+        }
+    }
+    return total_marcas;
+}
+
+// Lista los simbolos presentes en orden de simbolo y devuelve cuantos son
+static int listar_frecuencias(const uint64_t* conteo, FrecuenciaSimbolo* frecuencias) {
+    int num_simbolos = 0;
+    for (int s = 0; s < MAX_SIMBOLOS; s++) {
+        if (conteo[s] > 0) {
+            frecuencias[num_simbolos].simbolo = (char)s;
+            frecuencias[num_simbolos].frecuencia = conteo[s];
+            num_simbolos++;
+        }
+    }
+    return num_simbolos;
 }
 
-// Genera la tabla de codigos de huffman, recorriendo el arbol de manera recursiva
-void generar_tabla_codigos(NodoHuffman* nodo, string codigo_actual, CodigoHuffman* tabla, int& num_codigos) {
-    if (nodo == nullptr) return;
+// Codigos de un arbol indexados por simbolo, cada uno ya empaquetado en un entero
+struct CodigosSimbolo {
+    CodigoHuffman tabla[MAX_SIMBOLOS];
+    uint64_t bits[MAX_SIMBOLOS];
+    int largo[MAX_SIMBOLOS];
+    const string* codigo[MAX_SIMBOLOS];
+};
+
+static void preparar_codigos(FrecuenciaSimbolo* frecuencias, int num_simbolos, CodigosSimbolo& codigos) {
+    ArbolHuffman arbol;
+    construir_arbol_huffman(frecuencias, num_simbolos, arbol);
+    int num_codigos = 0;
+    generar_tabla_codigos(arbol, codigos.tabla, num_codigos);
     
-    // Si es un nodo hoja, guardar el código
-    if (nodo->izquierdo == nullptr && nodo->derecho == nullptr) {
-        tabla[num_codigos].simbolo = nodo->simbolo;
-        tabla[num_codigos].codigo = codigo_actual.empty() ? "0" : codigo_actual;
-        num_codigos++;
+    for (int s = 0; s < MAX_SIMBOLOS; s++) {
+        codigos.bits[s] = 0;
+        codigos.largo[s] = 0;
+        codigos.codigo[s] = nullptr;
+    }
+    for (int k = 0; k < num_codigos; k++) {
+        unsigned char c = codigos.tabla[k].simbolo;
+        const string& codigo = codigos.tabla[k].codigo;
+        codigos.largo[c] = codigo.size();
+        codigos.codigo[c] = &codigo;
+        for (size_t b = 0; b < codigo.size() && b < 64; b++) {
+            codigos.bits[c] = (codigos.bits[c] << 1) | (codigo[b] == '1' ? 1 : 0);
+        }
+    }
+}
+
+// Bytes que ocupa un texto con estos conteos al codificarlo con estos codigos, incluido el relleno final
+static uint64_t bytes_codificados(const uint64_t* conteo, const CodigosSimbolo& codigos) {
+    uint64_t bits = 0;
+    for (int s = 0; s < MAX_SIMBOLOS; s++) {
+        bits += conteo[s] * codigos.largo[s];
+    }
+    return (bits + 7) / 8;
+}
+
+// Bytes de una tabla de frecuencias en el archivo: n (2 bytes) y cada simbolo con su frecuencia (1 + 8 bytes)
+static uint64_t bytes_tabla(int num_simbolos) {
+    return 2 + 9 * (uint64_t)num_simbolos;
+}
+
+// Campos de una cabecera armados en memoria, en little-endian como en el archivo, para escribirlos de una
+// vez junto con su CRC32C. El lector arma los mismos campos con lo que leyo para comprobar el CRC
+class CamposBinarios {
+public:
+    void escribir_u8(uint8_t valor) { bytes.push_back(valor); }
+    void escribir_u16(uint16_t valor) { escribir_entero(valor, 2); }
+    void escribir_u32(uint32_t valor) { escribir_entero(valor, 4); }
+    void escribir_u64(uint64_t valor) { escribir_entero(valor, 8); }
+    void escribir_bytes(const void* datos, size_t n) {
+        const uint8_t* origen = static_cast<const uint8_t*>(datos);
+        bytes.insert(bytes.end(), origen, origen + n);
+    }
+
+    const uint8_t* datos() const { return bytes.data(); }
+    size_t tam() const { return bytes.size(); }
+    uint32_t crc() const { return crc32c(0, bytes.data(), bytes.size()); }
+
+private:
+    vector<uint8_t> bytes;
+
+    void escribir_entero(uint64_t valor, int n) {
+        for (int i = 0; i < n; i++) {
+            bytes.push_back((uint8_t)(valor >> (8 * i)));
+        }
+    }
+};
+
+// Cabecera de un archivo .fabin
+struct CabeceraFabin {
+    bool con_cabecera;      // false en los archivos anteriores a la magia
+    uint8_t version;        // 0 si no tiene cabecera
+    int escape;             // Simbolo de escape de las marcas de racha, -1 si no hay
+    bool mascara;           // Las secuencias llevan su mascara suave (OPCION_MASCARA)
+    uint16_t n;
+    FrecuenciaSimbolo frecuencias[MAX_SIMBOLOS];
+    uint32_t ns;
+};
+
+// Datos de una secuencia de un archivo .fabin, sin sus bits
+struct RegistroFabin {
+    string descripcion;
+    uint64_t wi;
+    uint32_t xi;
+    bool xi_largo;          // Version 6 o posterior: xi ocupa 4 bytes
+    uint8_t tabla;
+    uint32_t referencia;    // Posicion de la secuencia identica anterior (con TABLA_REFERENCIA)
+    uint16_t n_propios;
+    FrecuenciaSimbolo propias[MAX_SIMBOLOS];
+    bool con_mascara;       // Con OPCION_MASCARA: los bytes de la mascara suave estan presentes
+    vector<uint8_t> mascara; // Tramos en minuscula codificados con codificar_mascara
+    bool con_crc;           // Version 4 o posterior: los campos siguientes estan presentes
+    uint64_t bi;            // Bytes de la secuencia codificada
+    vector<uint32_t> crcs;  // CRC32C de cada bloque de la secuencia codificada
+};
+
+static void escribir_tabla(CamposBinarios& campos, const FrecuenciaSimbolo* frecuencias, int num_simbolos) {
+    campos.escribir_u16(num_simbolos);
+    for (int i = 0; i < num_simbolos; i++) {
+        campos.escribir_u8(frecuencias[i].simbolo);
+        campos.escribir_u64(frecuencias[i].frecuencia);
+    }
+}
+
+// Cabecera (magia: 2 bytes, version: 1 byte, opciones: 1 byte y, con rachas, el simbolo de escape: 1 byte),
+// la tabla global: la cantidad de bases diferentes (n: 2 bytes) y cada base con su frecuencia
+// (ci: 1 byte, fi: 8 bytes), y la cantidad de secuencias (ns: 4 bytes). En el archivo la sigue su CRC32C
+static void campos_cabecera(CamposBinarios& campos, const CabeceraFabin& cabecera) {
+    campos.escribir_u16(MAGIA_FABIN);
+    campos.escribir_u8(cabecera.version);
+    campos.escribir_u8((cabecera.escape >= 0 ? OPCION_RACHAS : 0) | (cabecera.mascara ? OPCION_MASCARA : 0));
+    if (cabecera.escape >= 0) {
+        campos.escribir_u8(cabecera.escape);
+    }
+    escribir_tabla(campos, cabecera.frecuencias, cabecera.n);
+    campos.escribir_u32(cabecera.ns);
+}
+
+// Datos de una secuencia: longitud del nombre (li: 2 bytes) y nombre, longitud de la secuencia (wi: 8 bytes),
+// ancho de linea (xi: 4 bytes; 2 antes de la version 6), tabla (ti: 1 byte, seguido de la tabla propia si la hay), con OPCION_MASCARA
+// la mascara suave (mi: 4 bytes y mi bytes) y bytes de la secuencia codificada (bi: 8 bytes).
+// En el archivo los siguen su CRC32C y el de cada bloque de BLOQUE_CRC
+// bytes de la secuencia codificada (4 bytes c/u). Una referencia lleva la posicion de la secuencia
+// identica (ri: 4 bytes) en lugar de bi y solo la sigue su CRC32C
+static void campos_registro(CamposBinarios& campos, const RegistroFabin& registro) {
+    campos.escribir_u16(registro.descripcion.size());
+    campos.escribir_bytes(registro.descripcion.data(), registro.descripcion.size());
+    campos.escribir_u64(registro.wi);
+    if (registro.xi_largo) {
+        campos.escribir_u32(registro.xi);
+    } else {
+        campos.escribir_u16(registro.xi);
+    }
+    campos.escribir_u8(registro.tabla);
+    if (registro.tabla == TABLA_REFERENCIA) {
+        campos.escribir_u32(registro.referencia);
         return;
     }
-    // Dado que todos los nodos internos tienen dos hijos, no es necesario verificar nullidad
-    // Recorrer subarbol izquierdo con "0"
-    generar_tabla_codigos(nodo->izquierdo, codigo_actual + "0", tabla, num_codigos);
-    
-    // Recorrer subarbol derecho con "1"
-    generar_tabla_codigos(nodo->derecho, codigo_actual + "1", tabla, num_codigos);
+    if (registro.tabla == TABLA_PROPIA) {
+        escribir_tabla(campos, registro.propias, registro.n_propios);
+    }
+    if (registro.con_mascara) {
+        campos.escribir_u32(registro.mascara.size());
+        campos.escribir_bytes(registro.mascara.data(), registro.mascara.size());
+    }
+    campos.escribir_u64(registro.bi);
 }
 
-// Escribir en binario 
-template<typename T>
-void escribir_binario(ofstream& archivo, T valor) {
-    archivo.write(reinterpret_cast<const char*>(&valor), sizeof(T));
+// Mascara suave de una secuencia: por cada tramo, la distancia desde el final del anterior (o desde el
+// principio) y su largo, como enteros de longitud variable (7 bits por byte; el bit alto indica que sigue otro)
+static void codificar_mascara(const MascaraSuave& mascara, vector<uint8_t>& destino) {
+    destino.clear();
+    uint64_t anterior = 0;
+    for (size_t t = 0; t < mascara.size(); t++) {
+        uint64_t valores[2] = {mascara[t].inicio - anterior, mascara[t].fin - mascara[t].inicio};
+        for (int v = 0; v < 2; v++) {
+            uint64_t valor = valores[v];
+            while (valor >= 0x80) {
+                destino.push_back((uint8_t)(valor | 0x80));
+                valor >>= 7;
+            }
+            destino.push_back((uint8_t)valor);
+        }
+        anterior = mascara[t].fin;
+    }
+}
+
+// Devuelve false si los bytes no describen tramos no vacios, separados entre si y dentro de la secuencia
+static bool decodificar_mascara(const vector<uint8_t>& bytes, uint64_t largo, MascaraSuave& mascara) {
+    mascara.clear();
+    uint64_t anterior = 0;
+    size_t pos = 0;
+    while (pos < bytes.size()) {
+        uint64_t valores[2];
+        for (int v = 0; v < 2; v++) {
+            valores[v] = 0;
+            for (int desplazamiento = 0;; desplazamiento += 7) {
+                if (pos == bytes.size() || desplazamiento > 63) return false;
+                uint8_t byte = bytes[pos++];
+                valores[v] |= (uint64_t)(byte & 0x7F) << desplazamiento;
+                if (!(byte & 0x80)) break;
+            }
+        }
+        if ((valores[0] == 0 && !mascara.empty()) || valores[1] == 0 || valores[0] > largo - anterior ||
+            valores[1] > largo - anterior - valores[0]) {
+            return false;
+        }
+        uint64_t inicio = anterior + valores[0];
+        mascara.push_back({inicio, inicio + valores[1]});
+        anterior = inicio + valores[1];
+    }
+    return true;
+}
+
+static uint64_t bloques_crc(uint64_t bytes) {
+    return (bytes + BLOQUE_CRC - 1) / BLOQUE_CRC;
+}
+
+static void agregar_codigo(EscritorBits& bits, const CodigosSimbolo& codigos, unsigned char simbolo) {
+    if (codigos.largo[simbolo] <= MAX_BITS_DIRECTOS) {
+        bits.agregar(codigos.bits[simbolo], codigos.largo[simbolo]);
+    } else {
+        const string& codigo = *codigos.codigo[simbolo];
+        for (size_t b = 0; b < codigo.size(); b++) {
+            bits.agregar(codigo[b] == '1' ? 1 : 0, 1);
+        }
+    }
+}
+
+// Cantidad de bits necesarios para escribir el valor (0 para el 0)
+static int bits_valor(uint64_t valor) {
+    int n = 0;
+    while (valor > 0) {
+        valor >>= 1;
+        n++;
+    }
+    return n;
+}
+
+// Escribe el texto codificado en binario, con relleno de 0s hasta el siguiente byte.
+// Con un simbolo de escape (>= 0), las rachas se escriben como marcas
+static void escribir_codificado(vector<uint8_t>& destino, const string& texto, const CodigosSimbolo& codigos,
+                                int escape) {
+    EscritorBits bits(destino);
+    size_t n = texto.size();
+    size_t j = 0;
+    while (j < n) {
+        unsigned char base = texto[j];
+        size_t fin = j + 1;
+        if (escape >= 0) {
+            while (fin < n && texto[fin] == texto[j]) {
+                fin++;
+            }
+        }
+        if (fin - j < UMBRAL_RACHA) {
+            for (; j < fin; j++) {
+                agregar_codigo(bits, codigos, base);
+            }
+            continue;
+        }
+        
+        uint64_t largo = fin - j;
+        uint64_t sueltas;
+        uint64_t marcas = repartir_racha(largo, sueltas);
+        for (uint64_t m = 0; m < marcas; m++) {
+            uint64_t bases = min(largo, MAX_RACHA);
+            uint64_t valor = bases - UMBRAL_RACHA;
+            int ancho = bits_valor(valor);
+            agregar_codigo(bits, codigos, base);
+            agregar_codigo(bits, codigos, escape);
+            bits.agregar(ancho, BITS_ANCHO_RACHA);
+            bits.agregar(valor, ancho);
+            largo -= bases;
+        }
+        for (uint64_t k = 0; k < sueltas; k++) {
+            agregar_codigo(bits, codigos, base);
+        }
+        j = fin;
+    }
+    bits.terminar();
 }
 
-// Funcion para leer de un binario, devuelve si se leyo correctamente
-template<typename T>
-bool leer_binario(ifstream& archivo, T& valor) {
-    archivo.read(reinterpret_cast<char*>(&valor), sizeof(T));
-    return archivo.good();
+// Para cada secuencia, la posicion de la primera secuencia anterior con las mismas bases (y la misma
+// mascara suave) o -1. Los textos se agrupan por su largo y su CRC32C, y cada candidato se confirma
+// comparando las bases completas
+static vector<int> buscar_repetidas(const vector<Bases>& todas) {
+    vector<int> referencias(todas.size(), -1);
+    unordered_map<uint64_t, vector<int> > vistos;
+    for (size_t i = 0; i < todas.size(); i++) {
+        const string& texto = todas[i]->texto;
+        uint64_t clave = ((uint64_t)crc32c(0, texto.data(), texto.size()) << 32) ^ texto.size();
+        vector<int>& candidatos = vistos[clave];
+        for (size_t c = 0; c < candidatos.size() && referencias[i] == -1; c++) {
+            const Bases& candidata = todas[candidatos[c]];
+            if (candidata == todas[i] || (candidata->texto == texto && candidata->suave == todas[i]->suave)) {
+                referencias[i] = candidatos[c];
+            }
+        }
+        if (referencias[i] == -1) {
+            candidatos.push_back(i);
+        }
+    }
+    return referencias;
 }
 
 // Codifica las secuencias en memoria y las guarda en un archivo binario .fabin
-void codificar(string nombreArchivo) {
+void codificar(string nombreArchivo, bool tablas_por_secuencia, bool rachas) {
+    Instantanea version = instantanea();
+    const vector<Secuencia>& secuencias = version->secuencias;
+    
     // Verificar si hay secuencias cargadas
     if (secuencias.empty()) {
-        cout << "No hay secuencias cargadas en memoria.\n";
+        salida() << "No hay secuencias cargadas en memoria.\n";
         return;
     }
     
-    // 1. Calcular frecuencias de todas las bases en todas las secuencias usando arreglo
-    FrecuenciaSimbolo frecuencias[MAX_SIMBOLOS];
-    int num_simbolos = 0;
+    // Las bases de todas las secuencias quedan en memoria durante toda la codificacion
+    vector<Bases> todas;
+    vector<const string*> textos;
+    todas.reserve(secuencias.size());
+    for (size_t i = 0; i < secuencias.size(); i++) {
+        todas.push_back(bases_de(secuencias[i]));
+        textos.push_back(&todas.back()->texto);
+    }
     
-    for (int i = 0; i < secuencias.size(); i++) {
-        for (int j = 0; j < secuencias[i].bases.size(); j++) {
-            char base = secuencias[i].bases[j];
-            
-            // Buscar si el simbolo ya existe
-            bool encontrado = false;
-            for (int k = 0; k < num_simbolos; k++) {
-                if (frecuencias[k].simbolo == base) {
-                    frecuencias[k].frecuencia++;
-                    encontrado = true;
-                    break;
-                }
-            }
-            
-            // Si no existe, agregarlo
-            if (!encontrado) {
-                frecuencias[num_simbolos].simbolo = base;
-                frecuencias[num_simbolos].frecuencia = 1;
-                num_simbolos++;
-            }
-        }
+    // 1. Buscar las secuencias repetidas: se guardan como referencias y no cuentan para las frecuencias
+    vector<int> referencias = buscar_repetidas(todas);
+    vector<const string*> unicos;
+    for (size_t i = 0; i < textos.size(); i++) {
+        if (referencias[i] == -1) unicos.push_back(textos[i]);
     }
     
+    // 2. Calcular frecuencias de todas las bases en las secuencias sin repetir, en paralelo
+    CabeceraFabin cabecera;
+    uint64_t conteo[MAX_SIMBOLOS];
+    uint64_t marcas = contar_simbolos(unicos, rachas, conteo);
+    
+    // Las marcas de racha usan como escape el primer byte que no aparece en ninguna secuencia
+    cabecera.escape = -1;
+    for (int s = 0; s < MAX_SIMBOLOS && marcas > 0 && cabecera.escape == -1; s++) {
+        if (conteo[s] == 0) cabecera.escape = s;
+    }
+    if (cabecera.escape == -1 && marcas > 0) {
+        contar_simbolos(unicos, false, conteo); // Aparecen los 256 bytes: no hay escape posible
+        marcas = 0;
+    }
+    if (cabecera.escape >= 0) {
+        conteo[cabecera.escape] = marcas;
+    }
+    cabecera.n = listar_frecuencias(conteo, cabecera.frecuencias);
+    
     // Verificar que haya al menos un simbolo
-    if (num_simbolos == 0) {
-        cout << "No se pueden guardar las secuencias cargadas en " << nombreArchivo << ".\n";
+    if (cabecera.n == 0) {
+        salida() << "No se pueden guardar las secuencias cargadas en " << nombreArchivo << ".\n";
         return;
     }
     
-    // 2. Construir el arbol de huffman
-    NodoHuffman* raiz = construir_arbol_huffman(frecuencias, num_simbolos);
-    
-    // 3. Generar la tabla de codigos
-    CodigoHuffman tabla_codigos[MAX_SIMBOLOS];
-    int num_codigos = 0;
-    generar_tabla_codigos(raiz, "", tabla_codigos, num_codigos);
+    // 3. Construir el arbol de huffman y la tabla de codigos global
+    CodigosSimbolo globales;
+    preparar_codigos(cabecera.frecuencias, cabecera.n, globales);
     
     // 4. Abrir el archivo binario para escritura
-    ofstream archivo(nombreArchivo, ios::binary);
-    if (!archivo.is_open()) {
-        cout << "No se pueden guardar las secuencias cargadas en " << nombreArchivo << ".\n";
-        liberar_arbol(raiz);
+    EscritorBinario archivo;
+    if (!archivo.abrir(nombreArchivo)) {
+        salida() << "No se pueden guardar las secuencias cargadas en " << nombreArchivo << ".\n";
         return;
     }
     
-    // 5. Escribir la cantidad de bases diferentes (n: 2 bytes)
-    uint16_t n = num_simbolos;
-    escribir_binario(archivo, n);
-    
-    // 6. Escribir cada base y su frecuencia (ci: 1 byte, fi: 8 bytes)
-    for (int i = 0; i < num_simbolos; i++) {
-        char ci = frecuencias[i].simbolo;
-        uint64_t fi = frecuencias[i].frecuencia;
-        escribir_binario(archivo, ci);
-        escribir_binario(archivo, fi);
+    // 5. Escribir la cabecera con la tabla global y la cantidad de secuencias, y su CRC32C.
+    //    Todos los enteros del archivo van en little-endian
+    cabecera.con_cabecera = true;
+    cabecera.version = VERSION_FABIN;
+    cabecera.ns = secuencias.size();
+    cabecera.mascara = false;
+    for (size_t i = 0; i < todas.size() && !cabecera.mascara; i++) {
+        cabecera.mascara = !todas[i]->suave.empty(); // Sin mascaras el archivo queda igual que antes
     }
+    CamposBinarios campos;
+    campos_cabecera(campos, cabecera);
+    archivo.escribir_bytes(campos.datos(), campos.tam());
+    archivo.escribir_u32(campos.crc());
     
-    // 7. Escribir la cantidad de secuencias (ns: 4 bytes)
-    uint32_t ns = secuencias.size();
-    escribir_binario(archivo, ns);
-    
-    // 8. Escribir cada secuencia
-    for (int idx = 0; idx < secuencias.size(); idx++) {
+    // 6. Escribir cada secuencia. Cada una se codifica primero en memoria porque sus datos incluyen
+    //    cuantos bytes ocupa y los CRC32C de sus bloques van antes que los bits
+    CodigosSimbolo propios;
+    RegistroFabin registro;
+    registro.con_crc = true;
+    registro.con_mascara = cabecera.mascara;
+    vector<uint8_t> codificada;
+    int con_tabla_propia = 0;
+    int repetidas = 0;
+    int con_mascara = 0;
+    for (size_t idx = 0; idx < secuencias.size(); idx++) {
         const Secuencia& sec = secuencias[idx];
+        const string& texto = *textos[idx];
         
-        // 8a. Longitud del nombre (li: 2 bytes)
-        uint16_t li = sec.descripcion.size();
-        escribir_binario(archivo, li);
-        
-        // 8b. Nombre de la secuencia (caracteres)
-        archivo.write(sec.descripcion.c_str(), li);
-        
-        // 8c. Longitud de la secuencia (wi: 8 bytes)
-        uint64_t wi = sec.bases.size();
-        escribir_binario(archivo, wi);
+        // 6a. Nombre, longitud y ancho de linea original
+        registro.descripcion = sec.descripcion.substr(0, UINT16_MAX);
+        registro.wi = texto.size();
+        registro.xi = sec.ancho_linea;
+        registro.xi_largo = true;
         
-        // 8d. justificacion/ancho de linea (xi: 2 bytes) - usar el ancho original
-        uint16_t xi = sec.ancho_linea;
-        escribir_binario(archivo, xi);
+        // 6b. Una secuencia repetida solo guarda la posicion de la anterior identica y su CRC32C
+        if (referencias[idx] != -1) {
+            registro.tabla = TABLA_REFERENCIA;
+            registro.referencia = referencias[idx];
+            CamposBinarios campos_secuencia;
+            campos_registro(campos_secuencia, registro);
+            archivo.escribir_bytes(campos_secuencia.datos(), campos_secuencia.tam());
+            archivo.escribir_u32(campos_secuencia.crc());
+            repetidas++;
+            continue;
+        }
         
-        // 8e. Codificar la secuencia en binario
-        string codigo_completo = "";
-        for (int j = 0; j < sec.bases.size(); j++) {
-            char base = sec.bases[j];
-            
-            // Buscar el código de esta base
-            for (int k = 0; k < num_codigos; k++) {
-                if (tabla_codigos[k].simbolo == base) {
-                    codigo_completo += tabla_codigos[k].codigo;
-                    break;
-                }
+        // 6c. Tabla de la secuencia. Una tabla propia solo se usa si lo que ahorra en bits
+        //     supera lo que ocupa en el archivo
+        registro.tabla = TABLA_GLOBAL;
+        if (tablas_por_secuencia && !texto.empty()) {
+            uint64_t conteo_propio[MAX_SIMBOLOS];
+            uint64_t marcas_propias = contar_simbolos(vector<const string*>(1, &texto), cabecera.escape >= 0, conteo_propio);
+            if (cabecera.escape >= 0) {
+                conteo_propio[cabecera.escape] = marcas_propias;
+            }
+            registro.n_propios = listar_frecuencias(conteo_propio, registro.propias);
+            preparar_codigos(registro.propias, registro.n_propios, propios);
+            if (bytes_codificados(conteo_propio, propios) + bytes_tabla(registro.n_propios) <
+                bytes_codificados(conteo_propio, globales)) {
+                registro.tabla = TABLA_PROPIA;
+                con_tabla_propia++;
             }
         }
         
-        // Relleno de 00 si no es multiplo de 8, para la lectura ya que solo lee bytes
-        while (codigo_completo.size() % 8 != 0) {
-            codigo_completo += "0";
+        // 6d. Mascara suave, aparte de las bases (que siempre estan en mayuscula)
+        if (cabecera.mascara) {
+            codificar_mascara(todas[idx]->suave, registro.mascara);
+            if (!todas[idx]->suave.empty()) con_mascara++;
         }
         
-        // Convertir string de bits a bytes y escribir
-        // .read solo permite escribir bytes
-        for (size_t i = 0; i < codigo_completo.size(); i += 8) {
-            uint8_t byte = 0;
-            for (int j = 0; j < 8; j++) {
-                if (codigo_completo[i + j] == '1') {
-                    byte |= (1 << (7 - j)); 
-                }
-            }
-            escribir_binario(archivo, byte);
+        // 6e. Codificar la secuencia en binario, con relleno de 0s hasta el siguiente byte
+        codificada.clear();
+        escribir_codificado(codificada, texto, registro.tabla == TABLA_PROPIA ? propios : globales, cabecera.escape);
+        registro.bi = codificada.size();
+        
+        // 6f. Datos de la secuencia y su CRC32C, el CRC32C de cada bloque y la secuencia codificada
+        CamposBinarios campos_secuencia;
+        campos_registro(campos_secuencia, registro);
+        archivo.escribir_bytes(campos_secuencia.datos(), campos_secuencia.tam());
+        archivo.escribir_u32(campos_secuencia.crc());
+        for (uint64_t inicio = 0; inicio < registro.bi; inicio += BLOQUE_CRC) {
+            archivo.escribir_u32(crc32c(0, &codificada[inicio], min(BLOQUE_CRC, registro.bi - inicio)));
         }
+        archivo.escribir_bytes(codificada.data(), codificada.size());
+        PERFIL_SUMAR(BASES_CODIFICADAS, texto.size());
     }
     
-    archivo.close();
-    liberar_arbol(raiz);
+    PERFIL_SUMAR(BYTES_CODIFICADOS, archivo.escritos());
+    if (!archivo.cerrar()) {
+        salida() << "No se pueden guardar las secuencias cargadas en " << nombreArchivo << ".\n";
+        return;
+    }
     
-    cout << "Secuencias codificadas y almacenadas en " << nombreArchivo << ".\n";
+    salida() << "Secuencias codificadas y almacenadas en " << nombreArchivo << ".\n";
+    if (tablas_por_secuencia) {
+        salida() << con_tabla_propia << " de " << secuencias.size() << " secuencias usan su propia tabla de codigos.\n";
+    }
+    if (repetidas > 0) {
+        salida() << repetidas << " secuencias repetidas se guardaron como referencias a la primera aparicion.\n";
+    }
+    if (con_mascara > 0) {
+        salida() << con_mascara << " secuencias guardan su mascara suave.\n";
+    }
+    if (rachas) {
+        salida() << "Rachas de " << UMBRAL_RACHA << " o mas bases iguales codificadas como " << marcas << " marcas.\n";
+    }
 }
 
-// Decodifica un archivo binario .fabin y carga las secuencias en memoria
-void decodificar(string nombreArchivo) {
-    // Abrir el archivo binario para lectura
-    ifstream archivo(nombreArchivo, ios::binary);
-    if (!archivo.is_open()) {
-        cout << "No se pueden cargar las secuencias desde " << nombreArchivo << ".\n";
-        return;
+// Lee las n bases de una tabla y sus frecuencias
+static bool leer_frecuencias(LectorBinario& archivo, FrecuenciaSimbolo* frecuencias, uint16_t n) {
+    if (n == 0 || n > MAX_SIMBOLOS) {
+        return false;
     }
-    
-    // 1. Leer la cantidad de bases diferentes (n: 2 bytes)
+    for (int i = 0; i < n; i++) {
+        uint8_t ci;
+        uint64_t fi;
+        if (!archivo.leer_u8(ci) || !archivo.leer_u64(fi)) {
+            return false;
+        }
+        frecuencias[i].simbolo = ci;
+        frecuencias[i].frecuencia = fi;
+    }
+    return true;
+}
+
+// Lee la cabecera, la tabla global y la cantidad de secuencias, y comprueba su CRC32C (desde la version 4).
+// Los archivos sin cabecera empiezan directamente con n
+static bool leer_cabecera(LectorBinario& archivo, CabeceraFabin& cabecera) {
     uint16_t n;
-        if (!leer_binario(archivo, n)) {
-            archivo.close();
-            cout << "No se pueden cargar las secuencias desde " << nombreArchivo << ".\n";
-            return;
+    if (!archivo.leer_u16(n)) {
+        return false;
+    }
+    cabecera.con_cabecera = (n == MAGIA_FABIN);
+    cabecera.version = 0;
+    cabecera.escape = -1;
+    cabecera.mascara = false;
+    if (cabecera.con_cabecera) {
+        if (!archivo.leer_u8(cabecera.version) || cabecera.version > VERSION_FABIN) {
+            return false;
         }
         
-        // 2. Leer cada base y su frecuencia para reconstruir el arbol
-        FrecuenciaSimbolo frecuencias[MAX_SIMBOLOS];
-        for (int i = 0; i < n; i++) {
-            char ci;
-            uint64_t fi;
-            if (!leer_binario(archivo, ci)) {
-                archivo.close();
-                cout << "No se pueden cargar las secuencias desde " << nombreArchivo << ".\n";
-                return;
+        // Opciones del archivo (desde la version 3)
+        uint8_t opciones = 0;
+        if (cabecera.version >= 3 && (!archivo.leer_u8(opciones) || (opciones & ~(OPCION_RACHAS | OPCION_MASCARA)) != 0)) {
+            return false;
+        }
+        if (opciones & OPCION_RACHAS) {
+            uint8_t simbolo;
+            if (!archivo.leer_u8(simbolo)) {
+                return false;
             }
-            if (!leer_binario(archivo, fi)) {
-                archivo.close();
-                cout << "No se pueden cargar las secuencias desde " << nombreArchivo << ".\n";
-                return;
+            cabecera.escape = simbolo;
+        }
+        cabecera.mascara = (opciones & OPCION_MASCARA) != 0;
+        if (!archivo.leer_u16(n)) {
+            return false;
+        }
+    }
+    cabecera.n = n;
+    if (!leer_frecuencias(archivo, cabecera.frecuencias, n) || !archivo.leer_u32(cabecera.ns)) {
+        return false;
+    }
+    
+    if (cabecera.version >= 4) {
+        uint32_t crc;
+        CamposBinarios campos;
+        campos_cabecera(campos, cabecera);
+        if (!archivo.leer_u32(crc) || crc != campos.crc()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Lee los datos de una secuencia hasta justo antes de sus bits y comprueba su CRC32C (desde la version 4)
+static bool leer_registro(LectorBinario& archivo, const CabeceraFabin& cabecera, RegistroFabin& registro) {
+    // Longitud del nombre (li: 2 bytes) y nombre
+    uint16_t li;
+    if (!archivo.leer_u16(li)) {
+        return false;
+    }
+    registro.descripcion.assign(li, '\0');
+    
+    // Longitud de la secuencia (wi: 8 bytes) y ancho de linea (xi: 4 bytes, 2 antes de la version 6)
+    if (!archivo.leer_bytes(&registro.descripcion[0], li) || !archivo.leer_u64(registro.wi)) {
+        return false;
+    }
+    registro.xi_largo = cabecera.version >= 6;
+    uint16_t xi_corto;
+    if (registro.xi_largo ? !archivo.leer_u32(registro.xi) : !archivo.leer_u16(xi_corto)) {
+        return false;
+    }
+    if (!registro.xi_largo) {
+        registro.xi = xi_corto;
+    }
+    if (registro.xi == 0) {
+        return false;
+    }
+    
+    // Tabla de la secuencia (ti: 1 byte, desde la version 2; referencias desde la version 5)
+    registro.tabla = TABLA_GLOBAL;
+    if (cabecera.version >= 2) {
+        if (!archivo.leer_u8(registro.tabla) || registro.tabla > (cabecera.version >= 5 ? TABLA_REFERENCIA : TABLA_PROPIA)) {
+            return false;
+        }
+        if (registro.tabla == TABLA_PROPIA &&
+            (!archivo.leer_u16(registro.n_propios) || !leer_frecuencias(archivo, registro.propias, registro.n_propios))) {
+            return false;
+        }
+    }
+    
+    // Cada base codificada ocupa al menos un bit y, con rachas, cada byte codifica menos de MAX_RACHA bases
+    if (registro.tabla != TABLA_REFERENCIA && registro.wi / (cabecera.escape >= 0 ? MAX_RACHA : 8) > archivo.restantes()) {
+        return false;
+    }
+    
+    // Mascara suave (con OPCION_MASCARA); una referencia usa la de la secuencia identica
+    registro.con_mascara = cabecera.mascara && registro.tabla != TABLA_REFERENCIA;
+    registro.mascara.clear();
+    if (registro.con_mascara) {
+        uint32_t mi;
+        if (!archivo.leer_u32(mi) || mi > archivo.restantes()) {
+            return false;
+        }
+        registro.mascara.resize(mi);
+        if (!archivo.leer_bytes(registro.mascara.data(), mi)) {
+            return false;
+        }
+    }
+    
+    // Bytes de la secuencia codificada, CRC32C de estos datos y de cada bloque (desde la version 4)
+    registro.crcs.clear();
+    registro.con_crc = cabecera.version >= 4;
+    registro.bi = 0;
+    if (registro.tabla == TABLA_REFERENCIA) {
+        uint32_t crc;
+        CamposBinarios campos;
+        if (!archivo.leer_u32(registro.referencia) || !archivo.leer_u32(crc)) {
+            return false;
+        }
+        campos_registro(campos, registro);
+        return crc == campos.crc();
+    }
+    if (registro.con_crc) {
+        uint32_t crc;
+        CamposBinarios campos;
+        if (!archivo.leer_u64(registro.bi) || !archivo.leer_u32(crc)) {
+            return false;
+        }
+        campos_registro(campos, registro);
+        uint64_t num_bloques = bloques_crc(registro.bi);
+        if (crc != campos.crc() || registro.bi > archivo.restantes() ||
+            num_bloques * 4 > archivo.restantes() - registro.bi) {
+            return false;
+        }
+        registro.crcs.resize(num_bloques);
+        for (uint64_t b = 0; b < num_bloques; b++) {
+            if (!archivo.leer_u32(registro.crcs[b])) {
+                return false;
             }
-            frecuencias[i].simbolo = ci;
-            frecuencias[i].frecuencia = fi;
         }
-        
-        // 3. Reconstruir el arbol de Huffman
-        NodoHuffman* raiz = construir_arbol_huffman(frecuencias, n);
-        
-        // 4. Leer la cantidad de secuencias (ns: 4 bytes)
-        uint32_t ns;
-        if (!leer_binario(archivo, ns)) {
-            liberar_arbol(raiz);
-            archivo.close();
-            cout << "No se pueden cargar las secuencias desde " << nombreArchivo << ".\n";
-            return;
+    }
+    return true;
+}
+
+// Decodifica la secuencia binaria directamente sobre 'destino', que ya tiene la longitud de la secuencia.
+// Al llegar al simbolo de escape (si hay, >= 0) se leen los campos de la marca y la racha se completa
+// repitiendo la base anterior con memset. Si el registro trae CRC32C (desde la version 4), cada bloque
+// se comprueba antes de decodificar su ultima parte, asi que un archivo danado falla en cuanto se lee
+// el bloque afectado
+static bool decodificar_bits(LectorBinario& archivo, const ArbolHuffman& arbol, int escape,
+                             const RegistroFabin& registro, string& destino) {
+    const vector<NodoHuffman>& nodos = arbol.nodos;
+    bool con_crc = registro.con_crc;
+    uint64_t wi = destino.size();
+    uint64_t escritas = 0;
+    uint64_t leidos = 0;        // Bytes de la secuencia codificada ya consumidos
+    uint32_t crc = 0;           // CRC32C acumulado del bloque en curso
+    int32_t nodo_actual = arbol.raiz;
+    int campo = 0;             // Bits que faltan del campo de la marca en curso (0 fuera de una marca)
+    bool leyendo_ancho = false; // El campo en curso es el ancho (si no, es el largo de la racha)
+    uint64_t valor = 0;
+    
+    while (escritas < wi) {
+        // Procesar todos los bytes contiguos disponibles de una vez
+        size_t disponibles = archivo.disponibles();
+        if (disponibles == 0) {
+            return false;
         }
+        const uint8_t* bytes = archivo.actual();
         
-        // 5. Limpiar secuencias anteriores en memoria
-        secuencias.clear();
-        
-        // 6. Leer cada secuencia
-        for (uint32_t i = 0; i < ns; i++) {
-            // 6a. Longitud del nombre (li: 2 bytes)
-            uint16_t li;
-            if (!leer_binario(archivo, li)) {
-                liberar_arbol(raiz);
-                archivo.close();
-                cout << "No se pueden cargar las secuencias desde " << nombreArchivo << ".\n";
-                return;
-            }
-            
-            // 6b. Leer el nombre
-            string descripcion(li, '\0');
-            archivo.read(&descripcion[0], li);
-            if (!archivo.good()) {
-                liberar_arbol(raiz);
-                archivo.close();
-                cout << "No se pueden cargar las secuencias desde " << nombreArchivo << ".\n";
-                return;
-            }
-            
-            // 6c. Longitud de la secuencia (wi: 8 bytes)
-            uint64_t wi;
-            if (!leer_binario(archivo, wi)) {
-                liberar_arbol(raiz);
-                archivo.close();
-                cout << "No se pueden cargar las secuencias desde " << nombreArchivo << ".\n";
-                return;
+        // Con CRC se procesa a lo sumo hasta el final del bloque en curso
+        if (con_crc) {
+            if (leidos >= registro.bi) {
+                return false;
             }
-            
-            // 6d. Ancho de linae (xi: 2 bytes)
-            uint16_t xi;
-            if (!leer_binario(archivo, xi)) {
-                liberar_arbol(raiz);
-                archivo.close();
-                cout << "No se pueden cargar las secuencias desde " << nombreArchivo << ".\n";
-                return;
+            uint64_t fin_bloque = min(registro.bi, (leidos / BLOQUE_CRC + 1) * BLOQUE_CRC);
+            disponibles = min<uint64_t>(disponibles, fin_bloque - leidos);
+            crc = crc32c(crc, bytes, disponibles);
+            if (leidos + disponibles == fin_bloque) {
+                if (crc != registro.crcs[leidos / BLOQUE_CRC]) {
+                    return false;
+                }
+                crc = 0;
             }
+        }
+        size_t consumidos = 0;
+        
+        while (consumidos < disponibles && escritas < wi) {
+            uint8_t byte = bytes[consumidos++];
             
-            // 6e. Decodificar la secuencia binaria
-            string bases_decodificadas = "";
-            NodoHuffman* nodo_actual = raiz;
-            
-            // Leer bytes y decodificar hasta obtener wi bases
-            while (bases_decodificadas.size() < wi) {
-                uint8_t byte;
-                if (!leer_binario(archivo, byte)) {
-                    liberar_arbol(raiz);
-                    archivo.close();
-                    cout << "No se pueden cargar las secuencias desde " << nombreArchivo << ".\n";
-                    return;
+            // Procesar cada bit del byte
+            for (int bit = 7; bit >= 0 && escritas < wi; bit--) {
+                if (campo > 0) {
+                    valor = (valor << 1) | ((byte >> bit) & 1);
+                    if (--campo > 0) continue;
+                    if (leyendo_ancho) {
+                        leyendo_ancho = false;
+                        campo = valor;
+                        valor = 0;
+                        if (campo > MAX_BITS_RACHA) return false;
+                        if (campo > 0) continue;
+                    }
+                    uint64_t copias = valor + UMBRAL_RACHA - 1; // La base de la marca ya se escribio
+                    if (copias > wi - escritas) return false;
+                    memset(&destino[escritas], destino[escritas - 1], copias);
+                    escritas += copias;
+                    continue;
+                }
+                
+                // Bajar por el arbol segun el bit
+                if (byte & (1 << bit)) {
+                    nodo_actual = nodos[nodo_actual].derecho;
+                } else {
+                    nodo_actual = nodos[nodo_actual].izquierdo;
+                }
+                
+                // Un bit que no corresponde a ninguna rama indica un archivo corrupto
+                if (nodo_actual == -1) {
+                    return false;
                 }
                 
-                // Procesar cada bit del byte
-                for (int bit = 7; bit >= 0 && bases_decodificadas.size() < wi; bit--) {
-                    bool es_uno = (byte & (1 << bit)) != 0;
-                    
-                    // Bajar por el arbol segun el bit
-                    if (es_uno) {
-                        nodo_actual = nodo_actual->derecho;
+                // Al llegar a una hoja se agrega el simbolo o empieza una marca de racha
+                if (nodos[nodo_actual].es_hoja()) {
+                    if ((unsigned char)nodos[nodo_actual].simbolo == escape) {
+                        if (escritas == 0) return false; // Una marca siempre sigue a su base
+                        leyendo_ancho = true;
+                        campo = BITS_ANCHO_RACHA;
+                        valor = 0;
                     } else {
-                        nodo_actual = nodo_actual->izquierdo;
-                    }
-                    
-                    // Al llegar a una hoja se agrega el simbolo 
-                    if (nodo_actual->izquierdo == nullptr && nodo_actual->derecho == nullptr) {
-                        bases_decodificadas += nodo_actual->simbolo;
-                        nodo_actual = raiz; // Reiniciar desde la raíz
+                        destino[escritas++] = nodos[nodo_actual].simbolo;
                     }
+                    nodo_actual = arbol.raiz; // Reiniciar desde la raíz
                 }
             }
-            
-            // Agregar la secuencia decodificada a memoria con su ancho de línea
-            secuencias.push_back({descripcion, bases_decodificadas, (int)xi});
+        }
+        archivo.avanzar(consumidos);
+        leidos += consumidos;
+    }
+    
+    // Con CRC la secuencia tiene que ocupar exactamente los bytes declarados
+    return !con_crc || leidos == registro.bi;
+}
+
+// Lee y decodifica un archivo .fabin completo en 'leidas'. Devuelve false si el archivo
+// no se puede abrir o esta incompleto o corrupto
+static bool leer_fabin(const string& nombreArchivo, vector<Secuencia>& leidas) {
+    // Abrir el archivo binario para lectura
+    LectorBinario archivo;
+    if (!archivo.abrir(nombreArchivo)) {
+        return false;
+    }
+    
+    // 1. Leer la cabecera, la tabla global y la cantidad de secuencias
+    CabeceraFabin cabecera;
+    if (!leer_cabecera(archivo, cabecera)) {
+        return false;
+    }
+    
+    // 2. Reconstruir el arbol de Huffman con el mismo metodo con el que se escribio el archivo
+    ArbolHuffman arbol;
+    if (cabecera.con_cabecera) {
+        construir_arbol_huffman(cabecera.frecuencias, cabecera.n, arbol);
+    } else {
+        construir_arbol_huffman_heredado(cabecera.frecuencias, cabecera.n, arbol);
+    }
+    ArbolHuffman arbol_propio; // Se reutiliza entre las secuencias que traen su propia tabla
+    
+    // 3. Leer cada secuencia
+    leidas.reserve(min<uint64_t>(cabecera.ns, archivo.restantes() / 12)); // Cada secuencia ocupa al menos 12 bytes
+    RegistroFabin registro;
+    for (uint32_t i = 0; i < cabecera.ns; i++) {
+        // 3a. Nombre, longitud, ancho de linea y tabla de la secuencia
+        if (!leer_registro(archivo, cabecera, registro)) {
+            return false;
+        }
+        
+        // Una secuencia repetida comparte las bases ya decodificadas de la anterior identica
+        if (registro.tabla == TABLA_REFERENCIA) {
+            if (registro.referencia >= i || leidas[registro.referencia].bases->texto.size() != registro.wi) {
+                return false;
+            }
+            leidas.push_back(Secuencia());
+            leidas.back().descripcion.swap(registro.descripcion);
+            leidas.back().bases = leidas[registro.referencia].bases;
+            leidas.back().ancho_linea = registro.xi;
+            continue;
+        }
+        const ArbolHuffman* arbol_secuencia = &arbol;
+        if (registro.tabla == TABLA_PROPIA) {
+            construir_arbol_huffman(registro.propias, registro.n_propios, arbol_propio);
+            arbol_secuencia = &arbol_propio;
         }
         
-        liberar_arbol(raiz);
-        archivo.close();
+        // 3b. Decodificar la secuencia binaria directamente sobre el string de destino
+        string bases_decodificadas(registro.wi, '\0');
+        MascaraSuave mascara;
+        if (!decodificar_mascara(registro.mascara, registro.wi, mascara) ||
+            !decodificar_bits(archivo, *arbol_secuencia, cabecera.escape, registro, bases_decodificadas)) {
+            return false;
+        }
         
-        cout << "Secuencias decodificadas desde " << nombreArchivo << " y cargadas en memoria.\n";
-}
\ No newline at end of file
+        // Agregar la secuencia decodificada con su ancho de línea y su mascara suave
+        leidas.push_back(Secuencia());
+        leidas.back().descripcion.swap(registro.descripcion);
+        leidas.back().bases = crear_bases(bases_decodificadas, mascara);
+        leidas.back().ancho_linea = registro.xi;
+        PERFIL_SUMAR(BASES_DECODIFICADAS, registro.wi);
+    }
+    
+    return true;
+}
+
+// Bloque de una secuencia codificada pendiente de verificar
+struct BloqueVerificar {
+    const uint8_t* datos;
+    size_t tam;
+    uint32_t crc;
+    uint32_t secuencia;
+};
+
+// Comando: verificar
+void verificar(string nombreArchivo) {
+    LectorBinario archivo;
+    CabeceraFabin cabecera;
+    if (!archivo.abrir(nombreArchivo)) {
+        salida() << "No se puede abrir " << nombreArchivo << ".\n";
+        return;
+    }
+    if (!leer_cabecera(archivo, cabecera)) {
+        salida() << "Error: La cabecera de " << nombreArchivo << " esta incompleta o danada.\n";
+        return;
+    }
+    if (cabecera.version < 4) {
+        salida() << "El archivo " << nombreArchivo << " no tiene sumas de verificacion (formato anterior a la version 4).\n";
+        return;
+    }
+    
+    // 1. Recorrer los datos de las secuencias sin decodificarlas. Si el archivo esta proyectado en memoria
+    //    los bloques se apartan para verificarlos en paralelo; si no, se verifican a medida que se leen
+    vector<string> descripciones;
+    vector<uint64_t> longitudes;
+    vector<BloqueVerificar> bloques;
+    vector<char> danadas(cabecera.ns, false);
+    RegistroFabin registro;
+    for (uint32_t i = 0; i < cabecera.ns; i++) {
+        if (!leer_registro(archivo, cabecera, registro)) {
+            salida() << "Error: Los datos de la secuencia " << i + 1 << " de " << nombreArchivo
+                     << " estan incompletos o danados.\n";
+            return;
+        }
+        descripciones.push_back(registro.descripcion);
+        longitudes.push_back(registro.wi);
+        if (registro.tabla == TABLA_REFERENCIA &&
+            (registro.referencia >= i || longitudes[registro.referencia] != registro.wi)) {
+            danadas[i] = true;
+        }
+        for (uint64_t b = 0; b < registro.crcs.size(); b++) {
+            size_t tam = min(BLOQUE_CRC, registro.bi - b * BLOQUE_CRC);
+            if (archivo.en_memoria()) {
+                archivo.disponibles();
+                bloques.push_back({archivo.actual(), tam, registro.crcs[b], i});
+                archivo.avanzar(tam);
+                continue;
+            }
+            uint32_t crc = 0;
+            for (size_t restan = tam; restan > 0;) {
+                size_t hay = min<uint64_t>(archivo.disponibles(), restan);
+                if (hay == 0) {
+                    // Una tuberia o FIFO no tiene tamaño conocido: el corte solo se nota aqui
+                    salida() << "Error: Los datos de la secuencia " << i + 1 << " de " << nombreArchivo
+                             << " estan incompletos o danados.\n";
+                    return;
+                }
+                crc = crc32c(crc, archivo.actual(), hay);
+                archivo.avanzar(hay);
+                restan -= hay;
+            }
+            if (crc != registro.crcs[b]) danadas[i] = true;
+        }
+    }
+    
+    // 2. Verificar los bloques apartados: cada hilo toma el siguiente bloque pendiente
+    int num_hilos = thread::hardware_concurrency();
+    if (num_hilos < 1) num_hilos = 1;
+    if ((size_t)num_hilos > bloques.size()) num_hilos = max<size_t>(1, bloques.size());
+    vector<char> correcto(bloques.size(), true);
+    atomic<size_t> siguiente(0);
+    auto verificar_bloques = [&bloques, &correcto, &siguiente]() {
+        for (size_t b = siguiente++; b < bloques.size(); b = siguiente++) {
+            correcto[b] = crc32c(0, bloques[b].datos, bloques[b].tam) == bloques[b].crc;
+        }
+    };
+    vector<thread> hilos;
+    for (int t = 1; t < num_hilos; t++) {
+        hilos.push_back(thread(verificar_bloques));
+    }
+    verificar_bloques();
+    for (size_t t = 0; t < hilos.size(); t++) {
+        hilos[t].join();
+    }
+    for (size_t b = 0; b < bloques.size(); b++) {
+        if (!correcto[b]) danadas[bloques[b].secuencia] = true;
+    }
+    
+    // 3. Informar las secuencias danadas
+    uint32_t num_danadas = 0;
+    for (uint32_t i = 0; i < cabecera.ns; i++) {
+        if (danadas[i]) {
+            salida() << "Error: Los datos codificados de la secuencia " << descripciones[i] << " estan danados.\n";
+            num_danadas++;
+        }
+    }
+    if (archivo.disponibles() > 0) {
+        salida() << "Error: El archivo " << nombreArchivo << " tiene datos de mas despues de la ultima secuencia.\n";
+        return;
+    }
+    if (num_danadas > 0) {
+        salida() << num_danadas << " de " << cabecera.ns << " secuencias de " << nombreArchivo << " estan danadas.\n";
+        return;
+    }
+    salida() << "El archivo " << nombreArchivo << " es valido (" << cabecera.ns << " secuencias).\n";
+}
+
+// Decodifica un archivo binario .fabin y carga las secuencias en memoria.
+// Se decodifica en un vector aparte para no perder lo que hay en memoria si el archivo esta incompleto o corrupto
+void decodificar(string nombreArchivo) {
+    vector<Secuencia> leidas;
+    if (!leer_fabin(nombreArchivo, leidas)) {
+        salida() << "No se pueden cargar las secuencias desde " << nombreArchivo << ".\n";
+        return;
+    }
+    
+    // Reemplazar las secuencias anteriores en memoria
+    EdicionSecuencias edicion(false);
+    edicion.version().secuencias.swap(leidas);
+    edicion.version().reconstruir_indice();
+    edicion.publicar();
+    
+    salida() << "Secuencias decodificadas desde " << nombreArchivo << " y cargadas en memoria.\n";
+}
+
+// Decodifica varios archivos .fabin a la vez (un hilo por archivo) y agrega sus secuencias a las de memoria
+void decodificar_agregar(const string* archivos, int num_archivos) {
+    vector<vector<Secuencia> > leidas(num_archivos);
+    vector<char> correcto(num_archivos, false);
+    
+    vector<thread> hilos;
+    for (int f = 1; f < num_archivos; f++) {
+        hilos.push_back(thread([&leidas, &correcto, archivos, f]() {
+            correcto[f] = leer_fabin(archivos[f], leidas[f]);
+        }));
+    }
+    correcto[0] = leer_fabin(archivos[0], leidas[0]);
+    for (size_t t = 0; t < hilos.size(); t++) {
+        hilos[t].join();
+    }
+    
+    // Agregar en el orden en que se dieron los archivos, todos en la misma version nueva
+    EdicionSecuencias edicion;
+    for (int f = 0; f < num_archivos; f++) {
+        if (!correcto[f]) {
+            salida() << "No se pueden cargar las secuencias desde " << archivos[f] << ".\n";
+            continue;
+        }
+        size_t cantidad = leidas[f].size();
+        int omitidas = edicion.version().agregar(leidas[f]);
+        salida() << cantidad - omitidas << " secuencias decodificadas desde " << archivos[f] << " y agregadas a memoria.\n";
+        if (omitidas > 0) {
+            salida() << omitidas << " secuencias de " << archivos[f]
+                 << " se omitieron porque su descripcion ya existe en memoria.\n";
+        }
+    }
+    edicion.publicar();
+}
@@ -2,6 +2,7 @@
 #define HUFFMAN_H
 
 #include <string>
+#include <vector>
 #include <cstdint>
 
 using namespace std;
@@ -18,25 +19,61 @@ struct CodigoHuffman {
     string codigo;
 };
 
-// Nodo del arbol de Huffman
+// Nodo del arbol de Huffman. Los hijos son indices dentro del arreglo de nodos del arbol
 struct NodoHuffman {
     char simbolo;               // Simbolo (En nodos internos y raiz es '\0' nulo) implementacion estandar del arbol
     uint64_t frecuencia;        // Numero de veces que aparece el simbolo en la secuencia
-    NodoHuffman* izquierdo;     // Hijo izquierdo (etiqueta "0")
-    NodoHuffman* derecho;       // Hijo derecho (etiqueta "1")
+    int32_t izquierdo;          // Indice del hijo izquierdo (etiqueta "0"), -1 si no tiene
+    int32_t derecho;            // Indice del hijo derecho (etiqueta "1"), -1 si no tiene
     
     // Constructor
     NodoHuffman(char s, uint64_t f) 
-        : simbolo(s), frecuencia(f), izquierdo(nullptr), derecho(nullptr) {}
+        : simbolo(s), frecuencia(f), izquierdo(-1), derecho(-1) {}
+
+    bool es_hoja() const { return izquierdo == -1 && derecho == -1; }
+};
+
+// Arbol de Huffman guardado en un arreglo contiguo de nodos (hojas primero, luego nodos internos).
+// Se construye con una sola reserva de memoria y se libera de una vez, sin new/delete por nodo
+struct ArbolHuffman {
+    vector<NodoHuffman> nodos;
+    int32_t raiz;
+
+    ArbolHuffman() : raiz(-1) {}
 };
 
+// Cabecera de los archivos .fabin. Los archivos anteriores empiezan directamente con n (<= 256),
+// asi que un primer valor de 2 bytes igual a MAGIA_FABIN identifica el formato con version.
+// Version 2: cada secuencia indica si usa la tabla global o trae su propia tabla de frecuencias.
+// Version 3: byte de opciones en la cabecera (marcas de racha con su simbolo de escape).
+// Version 4: CRC32C de la cabecera, de los datos de cada secuencia y de cada bloque de sus bits.
+// Version 5: una secuencia identica a otra anterior se guarda como referencia a ella
+// Version 6: el ancho de linea de cada secuencia ocupa 4 bytes (con 2 un ancho de 65536 se perdia)
+// Bits del byte de opciones (desde la version 3):
+//   OPCION_RACHAS (1): las rachas se codifican como marcas; la cabecera trae ademas el simbolo de escape.
+//   OPCION_MASCARA (2): cada secuencia que no es referencia lleva su mascara suave entre la tabla y bi:
+//   mi (4 bytes) y mi bytes con, por cada tramo en minuscula, la distancia desde el final del anterior
+//   y su largo como enteros de longitud variable. Esta cubierta por el CRC32C de los datos de la secuencia
+const uint16_t MAGIA_FABIN = 0xFAB1;
+const uint8_t VERSION_FABIN = 6;
+
 // Funciones 
-void codificar(string nombreArchivo);
+// codificar: con tablas_por_secuencia, cada secuencia cuya composicion difiere lo bastante de la global
+// se codifica con su propia tabla, siempre que lo que ahorra supere lo que ocupa la tabla en el archivo.
+// Con rachas, las secuencias largas de una misma base (regiones enmascaradas, huecos '-', 'N') se
+// codifican como una marca (base, escape, largo) y el decodificador las rellena de una vez
+void codificar(string nombreArchivo, bool tablas_por_secuencia = false, bool rachas = false);
 void decodificar(string nombreArchivo);
 
+// Comando: verificar <archivo.fabin>
+// Comprueba todos los CRC32C del archivo en paralelo sin decodificar las secuencias
+void verificar(string nombreArchivo);
+
+void decodificar_agregar(const string* archivos, int num_archivos);
+
 // Funciones auxiliares para el arbol
-NodoHuffman* construir_arbol_huffman(FrecuenciaSimbolo* frecuencias, int num_simbolos);
-void generar_tabla_codigos(NodoHuffman* nodo, string codigo_actual, CodigoHuffman* tabla, int& num_codigos);
-void liberar_arbol(NodoHuffman* nodo);
+void construir_arbol_huffman(FrecuenciaSimbolo* frecuencias, int num_simbolos, ArbolHuffman& arbol);
+void construir_arbol_huffman_heredado(FrecuenciaSimbolo* frecuencias, int num_simbolos, ArbolHuffman& arbol);
+void generar_tabla_codigos(const ArbolHuffman& arbol, CodigoHuffman* tabla, int& num_codigos);
 
 #endif
@@ -0,0 +1,319 @@
+#include "secuencias.h"
+#include "interfaz.h"
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <condition_variable>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+const uint64_t MEMORIA_INDEXADO_DEFECTO = 1024; // MB de bases residentes por defecto
+
+// FASTA indexado proyectado en memoria y las bases ya materializadas de sus secuencias.
+// Cada secuencia diferida guarda un puntero compartido, asi que la proyeccion vive mientras alguna
+// version del conjunto (o un comando que aun la lee) la use, aunque otra carga ya la haya reemplazado
+class FastaIndexado {
+public:
+    FastaIndexado(const char* datos, size_t tam, uint64_t memoria_maxima, bool suave)
+        : datos(datos), tam(tam), memoria_maxima(memoria_maxima), suave(suave), memoria_residente(0), reloj_uso(0) {}
+
+    ~FastaIndexado() {
+        munmap(const_cast<char*>(datos), tam);
+    }
+
+    Bases materializar(const EntradaFai& fai);
+
+private:
+    struct Residente {
+        Bases bases;         // Nulo mientras un hilo la esta copiando
+        uint64_t ultimo_uso; // Marca para la politica LRU
+    };
+
+    const char* datos;
+    size_t tam;
+    uint64_t memoria_maxima;
+    bool suave;                 // Recordar las bases en minuscula como mascara suave
+    uint64_t memoria_residente; // Bytes de bases materializadas que guarda la cache
+
+    mutex candado; // Varios comandos pueden materializar a la vez
+    condition_variable copiada; // Avisa que una secuencia reservada ya tiene sus bases
+    unordered_map<uint64_t, Residente> residentes; // Por desplazamiento de la secuencia en el archivo
+    uint64_t reloj_uso;
+
+    bool descartar_lru();
+    Bases copiar_bases(const EntradaFai& fai) const;
+};
+
+// Recorre el FASTA proyectado y arma el indice. Todas las lineas de una secuencia, salvo la ultima,
+// deben tener el mismo ancho; si no, el archivo no se puede indexar
+static bool construir_indice(const char* datos, size_t tam, vector<string>& nombres, vector<EntradaFai>& entradas) {
+    size_t pos = 0;
+    while (pos < tam) {
+        // Buscar el fin de la linea actual
+        const char* fin = static_cast<const char*>(memchr(datos + pos, '\n', tam - pos));
+        size_t fin_linea = fin ? fin - datos : tam;
+
+        if (datos[pos] != '>') {
+            // Lineas antes de la primera cabecera o vacias entre secuencias
+            if (fin_linea > pos && !(fin_linea == pos + 1 && datos[pos] == '\r') && nombres.empty()) {
+                return false;
+            }
+            pos = fin_linea + 1;
+            continue;
+        }
+
+        // El nombre es la primera palabra de la cabecera, como en samtools
+        size_t inicio_nombre = pos + 1;
+        size_t fin_nombre = inicio_nombre;
+        while (fin_nombre < fin_linea && datos[fin_nombre] != ' ' && datos[fin_nombre] != '\t' &&
+               datos[fin_nombre] != '\r') {
+            fin_nombre++;
+        }
+        nombres.push_back(string(datos + inicio_nombre, fin_nombre - inicio_nombre));
+
+        EntradaFai entrada = {0, fin_linea + 1, 0, 0};
+        pos = fin_linea + 1;
+        bool ultima_corta = false; // Ya aparecio una linea mas corta (debe ser la ultima)
+        bool hubo_vacia = false;   // Ya aparecio una linea vacia: solo puede haber otras vacias hasta la cabecera
+
+        while (pos < tam && datos[pos] != '>') {
+            fin = static_cast<const char*>(memchr(datos + pos, '\n', tam - pos));
+            fin_linea = fin ? fin - datos : tam;
+            size_t bytes = fin_linea - pos + (fin ? 1 : 0);
+            size_t bases = fin_linea - pos;
+            if (bases > 0 && datos[fin_linea - 1] == '\r') bases--;
+
+            if (bases == 0) {
+                hubo_vacia = true;
+            } else if (hubo_vacia) {
+                return false; // Las posiciones de las lineas siguientes no respetarian el ancho del indice
+            } else {
+                if (entrada.bases_linea == 0) {
+                    entrada.bases_linea = bases;
+                    entrada.bytes_linea = bytes;
+                } else if (ultima_corta || bases > entrada.bases_linea) {
+                    return false;
+                }
+                if (bases < entrada.bases_linea || bytes != entrada.bytes_linea) {
+                    ultima_corta = true;
+                }
+                entrada.longitud += bases;
+            }
+            pos = fin_linea + 1;
+        }
+        entradas.push_back(entrada);
+    }
+    return true;
+}
+
+// Lee un indice .fai existente
+static bool leer_indice(const string& nombreFai, vector<string>& nombres, vector<EntradaFai>& entradas) {
+    ifstream archivo(nombreFai);
+    if (!archivo.is_open()) return false;
+
+    string linea;
+    while (getline(archivo, linea)) {
+        if (linea.empty()) continue;
+        stringstream ss(linea);
+        string nombre;
+        EntradaFai entrada;
+        if (!getline(ss, nombre, '\t') ||
+            !(ss >> entrada.longitud >> entrada.desplazamiento >> entrada.bases_linea >> entrada.bytes_linea)) {
+            return false;
+        }
+        nombres.push_back(nombre);
+        entradas.push_back(entrada);
+    }
+    return !nombres.empty();
+}
+
+// Escribe el indice en formato .fai; si no se puede (directorio de solo lectura) simplemente no se guarda
+static void escribir_indice(const string& nombreFai, const vector<string>& nombres, const vector<EntradaFai>& entradas) {
+    ofstream archivo(nombreFai);
+    if (!archivo.is_open()) return;
+    for (size_t i = 0; i < nombres.size(); i++) {
+        archivo << nombres[i] << "\t" << entradas[i].longitud << "\t" << entradas[i].desplazamiento << "\t"
+                << entradas[i].bases_linea << "\t" << entradas[i].bytes_linea << "\n";
+    }
+}
+
+// Comando: cargar_indexado
+void cargar_indexado(string nombreArchivo, string memoria_mb, bool suave) {
+    uint64_t limite = MEMORIA_INDEXADO_DEFECTO;
+    if (!memoria_mb.empty()) {
+        try {
+            limite = stoull(memoria_mb);
+        } catch (...) {
+            salida() << "Error: La memoria debe ser un numero entero de MB.\n";
+            return;
+        }
+    }
+
+    int fd = open(nombreArchivo.c_str(), O_RDONLY);
+    struct stat info;
+    if (fd < 0 || fstat(fd, &info) != 0 || !S_ISREG(info.st_mode)) {
+        if (fd >= 0) close(fd);
+        salida() << nombreArchivo << " no se encuentra o no puede leerse.\n";
+        return;
+    }
+    if (info.st_size == 0) {
+        close(fd);
+        salida() << nombreArchivo << " no contiene ninguna secuencia.\n";
+        return;
+    }
+
+    void* mapa = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); // La proyeccion sigue valida despues de cerrar el descriptor
+    if (mapa == MAP_FAILED) {
+        salida() << nombreArchivo << " no se encuentra o no puede leerse.\n";
+        return;
+    }
+    const char* datos = static_cast<const char*>(mapa);
+
+    // Usar el .fai existente si es mas reciente que el FASTA; si no, construirlo y guardarlo
+    string nombreFai = nombreArchivo + ".fai";
+    vector<string> nombres;
+    vector<EntradaFai> entradas;
+    struct stat info_fai;
+    bool fai_vigente = stat(nombreFai.c_str(), &info_fai) == 0 && info_fai.st_mtime >= info.st_mtime;
+    if (!fai_vigente || !leer_indice(nombreFai, nombres, entradas)) {
+        nombres.clear();
+        entradas.clear();
+        if (!construir_indice(datos, info.st_size, nombres, entradas)) {
+            munmap(mapa, info.st_size);
+            salida() << nombreArchivo << " no se puede indexar: las lineas de una secuencia deben tener el mismo ancho.\n";
+            return;
+        }
+        escribir_indice(nombreFai, nombres, entradas);
+    }
+
+    // Verificar que el indice no apunte fuera del archivo. Una secuencia no vacia necesita un ancho de linea
+    // y, si ocupa mas de una linea, que cada linea tenga su salto (si no, la copia no avanza o mezcla lineas)
+    for (size_t i = 0; i < entradas.size(); i++) {
+        const EntradaFai& e = entradas[i];
+        bool ancho_valido = e.longitud == 0 ||
+                            (e.bases_linea > 0 && (e.bytes_linea > e.bases_linea || e.longitud <= e.bases_linea));
+        uint64_t lineas = e.bases_linea == 0 ? 0 : (e.longitud + e.bases_linea - 1) / e.bases_linea;
+        uint64_t ultima = e.longitud - (lineas > 0 ? (lineas - 1) * e.bases_linea : 0);
+        if (!ancho_valido ||
+            (lineas > 0 && e.desplazamiento + (lineas - 1) * e.bytes_linea + ultima > (uint64_t)info.st_size)) {
+            munmap(mapa, info.st_size);
+            salida() << nombreFai << " no corresponde a " << nombreArchivo << ".\n";
+            return;
+        }
+    }
+
+    // Reemplazar las secuencias anteriores por las entradas del indice, sin leer ninguna base
+    shared_ptr<FastaIndexado> origen = make_shared<FastaIndexado>(datos, info.st_size, limite << 20, suave);
+    EdicionSecuencias edicion(false);
+    vector<Secuencia>& secuencias = edicion.version().secuencias;
+    for (size_t i = 0; i < nombres.size(); i++) {
+        Secuencia sec = Secuencia();
+        sec.descripcion = nombres[i];
+        sec.ancho_linea = entradas[i].bases_linea > 0 ? entradas[i].bases_linea : 80;
+        sec.origen = origen;
+        sec.fai = entradas[i];
+        secuencias.push_back(sec);
+    }
+    edicion.version().reconstruir_indice();
+    edicion.publicar();
+
+    if (secuencias.empty()) {
+        salida() << nombreArchivo << " no contiene ninguna secuencia.\n";
+    } else if (secuencias.size() == 1) {
+        salida() << "1 secuencia indexada correctamente desde " << nombreArchivo << ".\n";
+    } else {
+        salida() << secuencias.size() << " secuencias indexadas correctamente desde " << nombreArchivo << ".\n";
+    }
+}
+
+// Descarta las bases residentes usadas hace mas tiempo que ningun comando este usando.
+// Se llama con el candado tomado; la cache es la unica duena de las bases si use_count es 1
+bool FastaIndexado::descartar_lru() {
+    unordered_map<uint64_t, Residente>::iterator victima = residentes.end();
+    for (unordered_map<uint64_t, Residente>::iterator it = residentes.begin(); it != residentes.end(); ++it) {
+        if (it->second.bases.use_count() == 1 &&
+            (victima == residentes.end() || it->second.ultimo_uso < victima->second.ultimo_uso)) {
+            victima = it;
+        }
+    }
+    if (victima == residentes.end()) return false;
+
+    memoria_residente -= victima->second.bases->texto.size();
+    residentes.erase(victima);
+    return true;
+}
+
+Bases FastaIndexado::materializar(const EntradaFai& fai) {
+    unique_lock<mutex> bloqueo(candado);
+    unordered_map<uint64_t, Residente>::iterator it;
+    while ((it = residentes.find(fai.desplazamiento)) != residentes.end()) {
+        if (it->second.bases) {
+            it->second.ultimo_uso = ++reloj_uso;
+            return it->second.bases;
+        }
+        copiada.wait(bloqueo); // Otro hilo la esta copiando
+    }
+
+    // Reservar el lugar y hacer espacio; si todo esta en uso se excede el limite temporalmente
+    while (memoria_residente + fai.longitud > memoria_maxima && descartar_lru()) {
+    }
+    memoria_residente += fai.longitud;
+    Residente reservado = {nullptr, ++reloj_uso};
+    residentes.insert(make_pair(fai.desplazamiento, reservado));
+
+    // La copia se hace sin el candado, para no detener a los comandos que buscan otras secuencias
+    bloqueo.unlock();
+    Bases bases;
+    try {
+        bases = copiar_bases(fai);
+    } catch (...) {
+        bloqueo.lock();
+        memoria_residente -= fai.longitud;
+        residentes.erase(fai.desplazamiento);
+        copiada.notify_all();
+        throw;
+    }
+    bloqueo.lock();
+
+    it = residentes.find(fai.desplazamiento);
+    it->second.bases = bases;
+    it->second.ultimo_uso = ++reloj_uso;
+    copiada.notify_all();
+    return bases;
+}
+
+// Copia las bases linea por linea desde la proyeccion, saltando los saltos de linea.
+// Igual que en cargar, se pasan a mayuscula; un caracter fuera de la Tabla 1 se convierte en 'N'
+// para no desplazar las coordenadas del indice. Con 'suave' las minusculas validas forman la mascara suave
+Bases FastaIndexado::copiar_bases(const EntradaFai& fai) const {
+    string texto(fai.longitud, 'N');
+    MascaraSuave mascara;
+    uint64_t copiadas = 0;
+    const char* linea = datos + fai.desplazamiento;
+    while (copiadas < fai.longitud) {
+        uint64_t n = min<uint64_t>(fai.bases_linea, fai.longitud - copiadas);
+        for (uint64_t k = 0; k < n; k++) {
+            char c = toupper((unsigned char)linea[k]);
+            bool valida = es_base_valida(c);
+            texto[copiadas + k] = valida ? c : 'N';
+            if (suave && valida && c != linea[k]) {
+                extender_mascara(mascara, copiadas + k, copiadas + k + 1);
+            }
+        }
+        copiadas += n;
+        linea += fai.bytes_linea;
+    }
+    return crear_bases(texto, mascara);
+}
+
+Bases bases_de(const Secuencia& sec) {
+    if (sec.bases) return sec.bases;
+    if (sec.origen) return sec.origen->materializar(sec.fai);
+    static const Bases vacias = make_shared<BasesSecuencia>(); // Una secuencia sin bases
+    return vacias;
+}
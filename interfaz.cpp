@@ -1,52 +1,81 @@
 #include "interfaz.h"
 #include <iostream>
-#include <sstream>
+#include <cctype>
 
 using namespace std;
 
 
 // Lista de nombres de comandos aceptados
 string comandos[NUM_COMANDOS] = {
-    "cargar", "listar_secuencias", "histograma", "es_subsecuencia",
-    "enmascarar", "guardar", "codificar", "decodificar",
-    "ruta_mas_corta", "base_remota", "ayuda", "salir"
+    "cargar", "cargar_agregar", "cargar_indexado", "listar_secuencias", "histograma", "es_subsecuencia",
+    "enmascarar", "ubicar_subsecuencia", "guardar", "kmers", "codificar", "decodificar", "decodificar_agregar",
+    "verificar", "perfil_composicion", "ruta_mas_corta", "base_remota", "base_remota_todas", "preprocesar_rutas", "servidor", "perfil", "ayuda", "salir"
 };
 
 // Ayudas asociadas a cada comando (en el mismo orden que el arreglo anterior)
 string ayudas[NUM_COMANDOS] = {
-    "Uso: cargar <archivo>. Carga un archivo FASTA.",
+    "Uso: cargar <archivo> [suave]. Carga un archivo FASTA, plano o comprimido con gzip/BGZF; con suave, recuerda las bases en minuscula (mascara suave).",
+    "Uso: cargar_agregar <archivo> [archivo ...] [suave]. Agrega las secuencias de uno o varios FASTA a las que ya estan en memoria.",
+    "Uso: cargar_indexado <archivo> [memoria_MB] [suave]. Indexa un FASTA (.fai) y lee cada secuencia solo cuando un comando la usa.",
     "Uso: listar_secuencias. Lista las secuencias en memoria.",
     "Uso: histograma <descripcion>. Muestra el histograma de una secuencia.",
-    "Uso: es_subsecuencia <sub>. Verifica si la subsecuencia está presente.",
-    "Uso: enmascarar <sub>. Enmascara la subsecuencia encontrada.",
-    "Uso: guardar <archivo>. Guarda las secuencias modificadas.",
-    "Uso: codificar <archivo.fabin>. Codifica las secuencias.",
+    "Uso: es_subsecuencia <sub> [ambas]. Verifica si la subsecuencia está presente; con 'ambas' busca tambien su complemento inverso en el mismo recorrido.",
+    "Uso: enmascarar <sub> [ambas] [suave]. Enmascara la subsecuencia encontrada con X; con 'ambas' enmascara tambien su complemento inverso y con 'suave' la pasa a minuscula sin cambiar las bases.",
+    "Uso: ubicar_subsecuencia <sub> [archivo_salida]. Escribe en formato TSV cada ubicacion (descripcion, desplazamiento, fila, columna, hebra) de la subsecuencia en ambas hebras.",
+    "Uso: guardar <archivo>. Guarda las secuencias modificadas; con extension .gz o .bgz se comprimen en BGZF.",
+    "Uso: kmers <k> [descripcion]. Cuenta los k-mers (k <= 32) sin codigos ambiguos y muestra los mas frecuentes y el espectro.",
+    "Uso: codificar <archivo.fabin> [por_secuencia] [rachas]. Codifica las secuencias; con por_secuencia, las de composicion distinta llevan su propia tabla de codigos; con rachas, las repeticiones largas de una base se guardan como una marca.",
     "Uso: decodificar <archivo.fabin>. Decodifica un archivo .fabin.",
-    "Uso: ruta_mas_corta <desc> <i> <j> <x> <y>. Calcula la ruta mas corta entre dos bases en el grafo.",
-    "Uso: base_remota <desc> <i> <j>. Encuentra la misma base mas lejana en la secuencia.",
+    "Uso: decodificar_agregar <archivo.fabin> [archivo.fabin ...]. Agrega las secuencias de uno o varios .fabin a las que ya estan en memoria.",
+    "Uso: verificar <archivo.fabin>. Comprueba en paralelo las sumas de verificacion (CRC32C) del archivo sin decodificar las secuencias.",
+    "Uso: perfil_composicion <desc|*> <ventana> <paso> <salida>. Escribe en formato TSV el contenido de GC, la densidad de codigos ambiguos y la cobertura de la mascara de cada ventana de una secuencia (o de todas con '*').",
+    "Uso: ruta_mas_corta <desc> <i> <j> <x> <y> [exacto]. Calcula la ruta mas corta entre dos bases en el grafo; con 'exacto' suma los pesos como fracciones enteras.",
+    "Uso: base_remota <desc> <i> <j> [exacto]. Encuentra la misma base mas lejana en la secuencia; con 'exacto' suma los pesos como fracciones enteras.",
+    "Uso: base_remota_todas <desc> <salida> [hilos]. Calcula en paralelo la base remota y su distancia para cada posicion y las escribe en un archivo binario; si se interrumpe, repetir el comando retoma el trabajo.",
+    "Uso: preprocesar_rutas <desc> <num_landmarks>. Calcula landmarks (1 a 32) que aceleran las siguientes consultas de ruta_mas_corta y los guarda en <desc>.alt.",
+    "Uso: servidor <socket> [hilos]. Atiende los comandos por un socket UNIX (cliente: bin/cliente <socket> [comando]) hasta que un cliente envia 'detener'.",
+    "Uso: perfil [json|reiniciar]. Muestra el tiempo de cada comando ejecutado (y sus contadores si se compilo con PERFIL=1).",
     "Uso: ayuda [comando]. Muestra ayuda general o específica.",
     "Uso: salir. Termina el programa."
 };
 
 // Función que divide una línea de texto por espacios y guarda las partes en un array
-// Devuelve la cantidad de partes que encontró
+// Devuelve la cantidad de palabras que encontró; si pasa de MAX_PARTES solo se guardan las primeras
+// y quien llama debe rechazar la linea. Las partes se reemplazan con assign, asi que
+// conservan su memoria de una linea a la siguiente; las que sobran quedan vacias
 int dividir(const string& input, string partes[]) {
-    stringstream ss(input); // Permite extraer palabras una por una
     int count = 0;
+    size_t i = 0;
 
-    // Mientras haya palabras y no se sobrepase el máximo
-    while (ss >> partes[count] && count < MAX_PARTES) {
+    // Mientras haya palabras; las que no caben solo se cuentan
+    while (true) {
+        while (i < input.size() && isspace((unsigned char)input[i])) i++;
+        if (i == input.size()) break;
+        size_t inicio = i;
+        while (i < input.size() && !isspace((unsigned char)input[i])) i++;
+        if (count < MAX_PARTES) partes[count].assign(input, inicio, i - inicio);
         count++;
     }
+    for (int k = count; k < MAX_PARTES; k++) {
+        partes[k].clear();
+    }
 
     return count;
 }
 
+// Indica si el nombre es uno de los comandos aceptados
+bool es_comando(const string& comando) {
+    for (int i = 0; i < NUM_COMANDOS; i++) {
+        if (comando == comandos[i]) return true;
+    }
+    return false;
+}
+
 // Muestra la lista general de comandos disponibles
 void mostrar_ayuda_general() {
-    cout << "Comandos disponibles:\n";
+    salida() << "Comandos disponibles:\n";
     for (int i = 0; i < NUM_COMANDOS; i++) {
-        cout << "  " << comandos[i] << "\n";
+        salida() << "  " << comandos[i] << "\n";
     }
 }
 
@@ -54,9 +83,27 @@ void mostrar_ayuda_general() {
 void mostrar_ayuda_comando(const string& comando) {
     for (int i = 0; i < NUM_COMANDOS; i++) {
         if (comando == comandos[i]) {
-            cout << ayudas[i] << "\n";
+            salida() << ayudas[i] << "\n";
             return;
         }
     }
-    cout << "Comando no reconocido. Usa 'ayuda' para ver todos los comandos.\n";
+    salida() << "Comando no reconocido. Usa 'ayuda' para ver todos los comandos.\n";
+}
+
+static thread_local ostream* destino_salida = nullptr; // nullptr = cout
+
+ostream& salida() {
+    return destino_salida != nullptr ? *destino_salida : cout;
+}
+
+ostream& salida_error() {
+    return destino_salida != nullptr ? *destino_salida : cerr;
+}
+
+RedireccionSalida::RedireccionSalida(ostream& destino) : anterior(destino_salida) {
+    destino_salida = &destino;
+}
+
+RedireccionSalida::~RedireccionSalida() {
+    destino_salida = anterior;
 }
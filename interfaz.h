@@ -2,13 +2,29 @@
 #define INTERFAZ_H
 
 #include <string>
+#include <ostream>
 using namespace std;
 // Const partes
 const int MAX_PARTES = 10;
-const int NUM_COMANDOS = 12; 
+const int NUM_COMANDOS = 23; 
 // Declaraciones de funciones para la interfaz de usuario
 int dividir(const string& input, string partes[]);
+bool es_comando(const string& comando);
 void mostrar_ayuda_general();
 void mostrar_ayuda_comando(const string& comando);
 
+// Destino de los mensajes de los comandos: cout en la consola. El servidor lo cambia en cada hilo
+// para que la respuesta de cada consulta vaya solo a su cliente
+ostream& salida();
+ostream& salida_error(); // cerr en la consola; con el servidor, el mismo destino que salida()
+
+class RedireccionSalida {
+public:
+    RedireccionSalida(ostream& destino);
+    ~RedireccionSalida(); // Restaura el destino anterior del hilo
+
+private:
+    ostream* anterior;
+};
+
 #endif 
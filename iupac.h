@@ -0,0 +1,146 @@
+#ifndef IUPAC_H
+#define IUPAC_H
+
+#include <cstdint>
+
+// Tablas del alfabeto IUPAC (Tabla 1) generadas en tiempo de compilacion.
+// Cada propiedad se define una sola vez como funcion constexpr de un caracter y se expande
+// a un arreglo de 256 entradas, de modo que los recorridos consultan un byte en lugar de
+// comparar contra listas de caracteres
+
+// Bases literales que puede representar un codigo; T y U son distintas para la compatibilidad
+const uint8_t LITERAL_A = 1;
+const uint8_t LITERAL_C = 2;
+const uint8_t LITERAL_G = 4;
+const uint8_t LITERAL_T = 8;
+const uint8_t LITERAL_U = 16;
+const uint8_t LITERAL_HUECO = 32;    // Solo la mascara X de la secuencia acepta un '-' del patron
+const uint8_t LITERAL_CUALQUIERA = 64; // Una X en el patron acepta cualquier codigo salvo '-'
+const uint8_t LITERAL_OTRO = 128;     // Codigos ambiguos o no validos en el patron: solo los acepta la X de la secuencia
+
+// Clases de simbolos, para resumir el alfabeto de una secuencia o de un patron
+const uint8_t CLASE_ACGT = 1;
+const uint8_t CLASE_U = 2;
+const uint8_t CLASE_AMBIGUA = 4;  // R, Y, K, M, S, W, B, D, H, V, N
+const uint8_t CLASE_X = 8;
+const uint8_t CLASE_HUECO = 16;
+const uint8_t CLASE_OTRA = 32;    // Cualquier caracter fuera de la Tabla 1
+
+// Propiedades de un caracter (en C++11 una funcion constexpr es una sola expresion)
+constexpr bool iupac_valida(int c) {
+    return c == 'A' || c == 'C' || c == 'G' || c == 'T' || c == 'U' || c == 'R' || c == 'Y' ||
+           c == 'K' || c == 'M' || c == 'S' || c == 'W' || c == 'B' || c == 'D' || c == 'H' ||
+           c == 'V' || c == 'N' || c == 'X' || c == '-';
+}
+
+// Literales que puede representar un codigo de la secuencia (la X los representa todos)
+constexpr uint8_t iupac_conjunto(int c) {
+    return c == 'A' ? LITERAL_A :
+           c == 'C' ? LITERAL_C :
+           c == 'G' ? LITERAL_G :
+           c == 'T' ? LITERAL_T :
+           c == 'U' ? LITERAL_U :
+           c == 'R' ? LITERAL_A | LITERAL_G :
+           c == 'Y' ? LITERAL_C | LITERAL_T | LITERAL_U :
+           c == 'K' ? LITERAL_G | LITERAL_T | LITERAL_U :
+           c == 'M' ? LITERAL_A | LITERAL_C :
+           c == 'S' ? LITERAL_C | LITERAL_G :
+           c == 'W' ? LITERAL_A | LITERAL_T | LITERAL_U :
+           c == 'B' ? LITERAL_C | LITERAL_G | LITERAL_T | LITERAL_U :
+           c == 'D' ? LITERAL_A | LITERAL_G | LITERAL_T | LITERAL_U :
+           c == 'H' ? LITERAL_A | LITERAL_C | LITERAL_T | LITERAL_U :
+           c == 'V' ? LITERAL_A | LITERAL_C | LITERAL_G :
+           c == 'N' ? LITERAL_A | LITERAL_C | LITERAL_G | LITERAL_T | LITERAL_U :
+           c == 'X' ? 0xFF :
+           c == '-' ? 0 :
+           0;
+}
+
+// Bit que un caracter del patron necesita encontrar entre los aceptados por el codigo de la secuencia
+constexpr uint8_t iupac_literal(int c) {
+    return c == 'A' ? LITERAL_A :
+           c == 'C' ? LITERAL_C :
+           c == 'G' ? LITERAL_G :
+           c == 'T' ? LITERAL_T :
+           c == 'U' ? LITERAL_U :
+           c == 'X' ? LITERAL_CUALQUIERA :
+           c == '-' ? LITERAL_HUECO :
+           LITERAL_OTRO;
+}
+
+// Conjunto del codigo mas la X del patron, que coincide con todo salvo '-'
+constexpr uint8_t iupac_aceptados(int c) {
+    return c == '-' ? 0 : (iupac_conjunto(c) | LITERAL_CUALQUIERA);
+}
+
+constexpr uint8_t iupac_bases_minimas(int c) {
+    return (iupac_valida(c) && c != '-') ? 1 : 0; // Cada codigo ocupa una posicion; '-' no cuenta
+}
+
+constexpr uint8_t iupac_complemento(int c) {
+    return c == 'A' ? 'T' : c == 'T' ? 'A' : c == 'U' ? 'A' :
+           c == 'C' ? 'G' : c == 'G' ? 'C' :
+           c == 'R' ? 'Y' : c == 'Y' ? 'R' :
+           c == 'K' ? 'M' : c == 'M' ? 'K' :
+           c == 'B' ? 'V' : c == 'V' ? 'B' :
+           c == 'D' ? 'H' : c == 'H' ? 'D' :
+           c; // S, W, N, X y '-' son su propio complemento
+}
+
+constexpr uint8_t iupac_clase(int c) {
+    return (c == 'A' || c == 'C' || c == 'G' || c == 'T') ? CLASE_ACGT :
+           c == 'U' ? CLASE_U :
+           c == 'X' ? CLASE_X :
+           c == '-' ? CLASE_HUECO :
+           iupac_valida(c) ? CLASE_AMBIGUA :
+           CLASE_OTRA;
+}
+
+constexpr int iupac_mayuscula(int c) {
+    return (c >= 'a' && c <= 'z') ? c - 'a' + 'A' : c;
+}
+
+// Caracter en mayuscula si es valido, 0 si se ignora al cargar un FASTA
+constexpr uint8_t iupac_filtro(int c) {
+    return iupac_valida(iupac_mayuscula(c)) ? iupac_mayuscula(c) : 0;
+}
+
+// Generacion de las tablas: una lista de indices 0..255 conocida por el compilador
+// se expande en la lista de inicializacion del arreglo
+template <int... I> struct Indices {};
+template <int N, int... I> struct GenerarIndices : GenerarIndices<N - 1, N - 1, I...> {};
+template <int... I> struct GenerarIndices<0, I...> { typedef Indices<I...> tipo; };
+
+struct TablaIupac {
+    uint8_t valor[256];
+    constexpr uint8_t operator[](unsigned char c) const { return valor[c]; }
+};
+
+template <uint8_t (*PROPIEDAD)(int), int... I>
+constexpr TablaIupac generar_tabla_iupac(Indices<I...>) {
+    return TablaIupac{{ PROPIEDAD(I)... }};
+}
+
+template <uint8_t (*PROPIEDAD)(int)>
+constexpr TablaIupac tabla_iupac() {
+    return generar_tabla_iupac<PROPIEDAD>(GenerarIndices<256>::tipo());
+}
+
+constexpr uint8_t iupac_valida_byte(int c) { return iupac_valida(c) ? 1 : 0; }
+
+constexpr TablaIupac TABLA_VALIDAS = tabla_iupac<iupac_valida_byte>();
+constexpr TablaIupac TABLA_ACEPTADOS = tabla_iupac<iupac_aceptados>(); // Por codigo de la secuencia
+constexpr TablaIupac TABLA_LITERALES = tabla_iupac<iupac_literal>();   // Por caracter del patron
+constexpr TablaIupac TABLA_BASES_MINIMAS = tabla_iupac<iupac_bases_minimas>();
+constexpr TablaIupac TABLA_COMPLEMENTO = tabla_iupac<iupac_complemento>();
+constexpr TablaIupac TABLA_CLASES = tabla_iupac<iupac_clase>();
+constexpr TablaIupac TABLA_FILTRO = tabla_iupac<iupac_filtro>();
+
+// Compatibilidad de un codigo de la secuencia con un caracter literal del patron:
+// iguales, o el literal esta entre los que acepta el codigo (X acepta todo; '-' solo a si mismo)
+inline bool iupac_compatibles(unsigned char codigo_secuencia, unsigned char codigo_patron) {
+    return codigo_secuencia == codigo_patron ||
+           (TABLA_ACEPTADOS[codigo_secuencia] & TABLA_LITERALES[codigo_patron]) != 0;
+}
+
+#endif
@@ -0,0 +1,282 @@
+#include "kmers.h"
+#include "secuencias.h"
+#include "interfaz.h"
+#include <iostream>
+#include <algorithm>
+#include <thread>
+
+using namespace std;
+
+// Codigo de 2 bits de una base concreta; -1 para codigos ambiguos, mascara 'X' o espacio '-'
+int codigo_2bits(char base) {
+    switch (base) {
+        case 'A': return 0;
+        case 'C': return 1;
+        case 'G': return 2;
+        case 'T': case 'U': return 3; // U (ARN) se cuenta como T
+        default: return -1;
+    }
+}
+
+// Convierte un k-mer codificado de vuelta a su texto
+string decodificar_kmer(uint64_t kmer, int k) {
+    const char letras[4] = {'A', 'C', 'G', 'T'};
+    string texto(k, 'A');
+    for (int i = k - 1; i >= 0; i--) {
+        texto[i] = letras[kmer & 3];
+        kmer >>= 2;
+    }
+    return texto;
+}
+
+// Mezcla de bits (splitmix64) para repartir los k-mers uniformemente en la tabla
+uint64_t mezclar_hash(uint64_t x) {
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+TablaKmers::TablaKmers(int bits_capacidad) : mascara(0), ocupadas(0), cuenta_vacia(0) {
+    EntradaKmer libre = {VACIA, 0};
+    casillas.assign((size_t)1 << bits_capacidad, libre);
+    mascara = casillas.size() - 1;
+}
+
+void TablaKmers::sumar(uint64_t kmer, uint64_t hash, uint64_t cuenta) {
+    if (kmer == VACIA) {
+        cuenta_vacia += cuenta;
+        return;
+    }
+
+    // Mantener el factor de carga por debajo de 1/2 para que los sondeos sean cortos
+    if ((ocupadas + 1) * 2 > casillas.size()) {
+        crecer();
+    }
+
+    uint64_t i = hash & mascara;
+    while (true) {
+        EntradaKmer& casilla = casillas[i];
+        if (casilla.kmer == kmer) {
+            casilla.cuenta += cuenta;
+            return;
+        }
+        if (casilla.kmer == VACIA) {
+            casilla.kmer = kmer;
+            casilla.cuenta = cuenta;
+            ocupadas++;
+            return;
+        }
+        i = (i + 1) & mascara;
+    }
+}
+
+void TablaKmers::sumar(const TablaKmers& otra) {
+    for (size_t j = 0; j < otra.casillas.size(); j++) {
+        if (otra.casillas[j].kmer != VACIA) {
+            sumar(otra.casillas[j].kmer, mezclar_hash(otra.casillas[j].kmer), otra.casillas[j].cuenta);
+        }
+    }
+    cuenta_vacia += otra.cuenta_vacia;
+}
+
+// Duplica la capacidad y reinserta las entradas existentes
+void TablaKmers::crecer() {
+    vector<EntradaKmer> anteriores;
+    anteriores.swap(casillas);
+
+    EntradaKmer libre = {VACIA, 0};
+    casillas.assign(anteriores.size() * 2, libre);
+    mascara = casillas.size() - 1;
+
+    for (size_t j = 0; j < anteriores.size(); j++) {
+        if (anteriores[j].kmer == VACIA) continue;
+        uint64_t i = mezclar_hash(anteriores[j].kmer) & mascara;
+        while (casillas[i].kmer != VACIA) {
+            i = (i + 1) & mascara;
+        }
+        casillas[i] = anteriores[j];
+    }
+}
+
+void TablaKmers::volcar(vector<EntradaKmer>& destino) const {
+    for (size_t i = 0; i < casillas.size(); i++) {
+        if (casillas[i].kmer != VACIA) {
+            destino.push_back(casillas[i]);
+        }
+    }
+    if (cuenta_vacia > 0) {
+        EntradaKmer entrada = {VACIA, cuenta_vacia};
+        destino.push_back(entrada);
+    }
+}
+
+// Particion de un k-mer segun su hash. Usa bits altos, independientes de la casilla (bits bajos) en la tabla
+static inline size_t particion_de(uint64_t hash, size_t num_particiones) {
+    return (hash >> 32) % num_particiones;
+}
+
+// Cuenta los k-mers que terminan en las posiciones [desde, hasta) de todas las secuencias puestas una
+// detras de otra. Cada hilo recorre un tramo distinto y empieza k - 1 bases antes para completar la
+// primera ventana, asi que cada k-mer se cuenta en un solo hilo. Las cuentas quedan repartidas por
+// particion del hash, para que despues cada particion se combine en un solo hilo
+static void contar_tramo(const vector<const string*>& textos, int k, uint64_t desde, uint64_t hasta,
+                         vector<TablaKmers>& particiones, uint64_t& total) {
+    uint64_t mascara_k = (k == 32) ? ~0ULL : ((1ULL << (2 * k)) - 1);
+    total = 0;
+
+    uint64_t desplazamiento = 0; // Posicion de la secuencia actual en el recorrido completo
+    for (size_t s = 0; s < textos.size() && desplazamiento < hasta; s++) {
+        const string& texto = *textos[s];
+        uint64_t fin_texto = desplazamiento + texto.size();
+        if (fin_texto > desde) {
+            size_t inicio = desde > desplazamiento ? desde - desplazamiento : 0;
+            size_t fin = min(hasta, fin_texto) - desplazamiento;
+            size_t lectura = inicio >= (size_t)(k - 1) ? inicio - (k - 1) : 0;
+            uint64_t kmer = 0;
+            int validas = 0; // Bases validas consecutivas en la ventana actual
+
+            for (size_t j = lectura; j < fin; j++) {
+                int codigo = codigo_2bits(texto[j]);
+                if (codigo < 0) {
+                    validas = 0; // La ventana contiene un codigo ambiguo, 'X' o '-': se descarta
+                    continue;
+                }
+                kmer = ((kmer << 2) | codigo) & mascara_k;
+                if (++validas < k) continue;
+
+                total++;
+                uint64_t hash = mezclar_hash(kmer);
+                particiones[particion_de(hash, particiones.size())].sumar(kmer, hash, 1);
+            }
+        }
+        desplazamiento = fin_texto;
+    }
+}
+
+// Ordena de mayor a menor cuenta, desempatando por k-mer para que la salida sea estable
+static bool mas_frecuente(const EntradaKmer& a, const EntradaKmer& b) {
+    if (a.cuenta != b.cuenta) return a.cuenta > b.cuenta;
+    return a.kmer < b.kmer;
+}
+
+// Comando: kmers
+void kmers(string k_str, string descripcion) {
+    Instantanea version = instantanea();
+    const vector<Secuencia>& secuencias = version->secuencias;
+    if (secuencias.empty()) {
+        salida() << "No hay secuencias cargadas en memoria.\n";
+        return;
+    }
+
+    int k;
+    try {
+        k = stoi(k_str);
+    } catch (...) {
+        salida() << "Error: k debe ser un numero entero.\n";
+        return;
+    }
+    if (k < 1 || k > MAX_K) {
+        salida() << "Error: k debe estar entre 1 y " << MAX_K << ".\n";
+        return;
+    }
+
+    // Seleccionar las secuencias a contar (todas o solo la indicada)
+    vector<Bases> seleccionadas; // Quedan en memoria durante todo el conteo
+    vector<const string*> textos;
+    uint64_t total_bases = 0;
+    for (size_t i = 0; i < secuencias.size(); i++) {
+        if (descripcion.empty() || secuencias[i].descripcion == descripcion) {
+            seleccionadas.push_back(bases_de(secuencias[i]));
+            textos.push_back(&seleccionadas.back()->texto);
+            total_bases += textos.back()->size();
+        }
+    }
+    if (textos.empty()) {
+        salida() << "Secuencia inválida.\n";
+        return;
+    }
+
+    // 1. Cada hilo cuenta un tramo de las bases en sus propias tablas, una por particion del hash
+    //    Las tablas son num_hilos x num_hilos, asi que los hilos se limitan por la cantidad de bases
+    int num_hilos = thread::hardware_concurrency();
+    if (num_hilos < 1) num_hilos = 1;
+    if ((uint64_t)num_hilos > total_bases / MIN_BASES_POR_HILO_KMERS) {
+        num_hilos = max<uint64_t>(1, total_bases / MIN_BASES_POR_HILO_KMERS);
+    }
+
+    int bits_iniciales = num_hilos == 1 ? 16 : 10; // Con muchas tablas por hilo cada una empieza chica
+    vector<vector<TablaKmers> > tablas(num_hilos, vector<TablaKmers>(num_hilos, TablaKmers(bits_iniciales)));
+    vector<uint64_t> totales(num_hilos, 0);
+    vector<thread> hilos;
+    for (int t = 1; t < num_hilos; t++) {
+        hilos.push_back(thread(contar_tramo, cref(textos), k, total_bases * t / num_hilos,
+                               total_bases * (t + 1) / num_hilos, ref(tablas[t]), ref(totales[t])));
+    }
+    contar_tramo(textos, k, 0, total_bases / num_hilos, tablas[0], totales[0]);
+    for (size_t t = 0; t < hilos.size(); t++) {
+        hilos[t].join();
+    }
+
+    // 2. Cada hilo combina una particion: las tablas de esa particion de todos los hilos se suman
+    //    sobre la del primero. Las particiones son disjuntas, asi que los hilos no comparten tablas
+    hilos.clear();
+    auto combinar = [&tablas, num_hilos](int p) {
+        for (int t = 1; t < num_hilos; t++) {
+            tablas[0][p].sumar(tablas[t][p]);
+            tablas[t][p] = TablaKmers(0); // La tabla ya sumada no se vuelve a usar
+        }
+    };
+    for (int p = 1; p < num_hilos; p++) {
+        hilos.push_back(thread(combinar, p));
+    }
+    combinar(0);
+    for (size_t t = 0; t < hilos.size(); t++) {
+        hilos[t].join();
+    }
+
+    uint64_t total = 0;
+    for (int t = 0; t < num_hilos; t++) {
+        total += totales[t];
+    }
+    if (total == 0) {
+        salida() << "No hay k-mers de longitud " << k << " sin codigos ambiguos en las secuencias seleccionadas.\n";
+        return;
+    }
+
+    vector<EntradaKmer> entradas;
+    uint64_t distintos = 0;
+    for (int p = 0; p < num_hilos; p++) {
+        distintos += tablas[0][p].distintos();
+    }
+    entradas.reserve(distintos);
+    for (int p = 0; p < num_hilos; p++) {
+        tablas[0][p].volcar(entradas);
+    }
+
+    salida() << "Se contaron " << total << " k-mers de longitud " << k << " (" << distintos << " distintos).\n";
+
+    // k-mers mas frecuentes
+    size_t top = min((size_t)TOP_KMERS, entradas.size());
+    partial_sort(entradas.begin(), entradas.begin() + top, entradas.end(), mas_frecuente);
+    salida() << "K-mers mas frecuentes:\n";
+    for (size_t i = 0; i < top; i++) {
+        salida() << decodificar_kmer(entradas[i].kmer, k) << " : " << entradas[i].cuenta << "\n";
+    }
+
+    // Espectro: cuantos k-mers distintos aparecen exactamente f veces
+    uint64_t espectro[MAX_ESPECTRO + 1] = {0};
+    for (size_t i = 0; i < entradas.size(); i++) {
+        uint64_t f = entradas[i].cuenta;
+        espectro[f < MAX_ESPECTRO ? f : MAX_ESPECTRO]++;
+    }
+    salida() << "Espectro (apariciones : k-mers distintos):\n";
+    for (int f = 1; f < MAX_ESPECTRO; f++) {
+        if (espectro[f] > 0) {
+            salida() << f << " : " << espectro[f] << "\n";
+        }
+    }
+    if (espectro[MAX_ESPECTRO] > 0) {
+        salida() << ">=" << MAX_ESPECTRO << " : " << espectro[MAX_ESPECTRO] << "\n";
+    }
+}
@@ -0,0 +1,52 @@
+#ifndef KMERS_H
+#define KMERS_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+using namespace std;
+
+const int MAX_K = 32;           // Un k-mer de hasta 32 bases cabe en un uint64 (2 bits por base)
+const int TOP_KMERS = 10;       // Cantidad de k-mers mas frecuentes que se muestran
+const int MAX_ESPECTRO = 20;    // Filas del espectro; las frecuencias mayores se agrupan en la ultima
+const uint64_t MIN_BASES_POR_HILO_KMERS = 1 << 20; // Cada hilo crea una tabla por hilo: con pocas bases no compensa
+
+// Entrada de la tabla hash: k-mer codificado y su numero de apariciones
+struct EntradaKmer {
+    uint64_t kmer;
+    uint64_t cuenta;
+};
+
+uint64_t mezclar_hash(uint64_t x);
+
+// Tabla hash de direccionamiento abierto (sondeo lineal) para contar k-mers.
+// Las entradas viven en un unico arreglo contiguo, por lo que cada sondeo toca pocas lineas de cache
+class TablaKmers {
+public:
+    TablaKmers(int bits_capacidad = 16);
+    void incrementar(uint64_t kmer) { sumar(kmer, mezclar_hash(kmer), 1); }
+    void sumar(uint64_t kmer, uint64_t hash, uint64_t cuenta); // 'hash' es mezclar_hash(kmer), ya calculado
+    void sumar(const TablaKmers& otra);                         // Agrega todas las cuentas de otra tabla
+    void volcar(vector<EntradaKmer>& destino) const; // Agrega las entradas ocupadas al vector
+    uint64_t distintos() const { return ocupadas + (cuenta_vacia > 0 ? 1 : 0); }
+
+private:
+    static const uint64_t VACIA = ~0ULL; // Marca de casilla libre
+
+    vector<EntradaKmer> casillas;
+    uint64_t mascara;       // capacidad - 1 (la capacidad siempre es potencia de 2)
+    uint64_t ocupadas;
+    uint64_t cuenta_vacia;  // Con k = 32 el k-mer TTT...T coincide con la marca VACIA y se cuenta aparte
+
+    void crecer();
+};
+
+// Funciones principales
+void kmers(string k_str, string descripcion = "");
+
+// Funciones auxiliares
+int codigo_2bits(char base);
+string decodificar_kmer(uint64_t kmer, int k);
+
+#endif
@@ -0,0 +1,252 @@
+#include "landmarks.h"
+#include "binario.h"
+#include "interfaz.h"
+#include <cmath>
+#include <cctype>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <sys/stat.h>
+
+using namespace std;
+
+// Formato del archivo .alt (enteros en little-endian):
+//   magia (4 bytes), version (1 byte), filas y columnas (4 bytes c/u), total de bases (8 bytes),
+//   huella (8 bytes), K (4 bytes), por landmark su indice (4 bytes) y escala (8 bytes, bits del double),
+//   y por ultimo las total * K distancias cuantizadas (2 bytes c/u), intercaladas por nodo
+const uint32_t MAGIA_ALT = 0x31544c41; // "ALT1"
+const uint8_t VERSION_ALT = 1;
+
+CotasRuta::CotasRuta(const LandmarksRuta* alt, int destino) : alt(alt), num(0) {
+    if (alt == nullptr || destino < 0) return;
+    num = alt->cantidad();
+    for (int l = 0; l < num; l++) {
+        objetivo[l] = alt->distancias[(size_t)destino * num + l];
+    }
+}
+
+uint64_t huella_bases(const string& texto, int ancho_linea) {
+    uint64_t h = 1469598103934665603ULL ^ (uint64_t)ancho_linea;
+    for (size_t i = 0; i < texto.size(); i++) {
+        h = (h ^ (unsigned char)texto[i]) * 1099511628211ULL;
+    }
+    return h;
+}
+
+// Nombre del archivo de cache: la descripcion con los caracteres problematicos reemplazados
+static string archivo_landmarks(const string& descripcion) {
+    string nombre = descripcion;
+    for (size_t i = 0; i < nombre.size(); i++) {
+        char c = nombre[i];
+        if (!isalnum((unsigned char)c) && c != '.' && c != '-' && c != '_') nombre[i] = '_';
+    }
+    return nombre + ".alt";
+}
+
+static shared_ptr<LandmarksRuta> calcular_landmarks(const GrafoSecuencia& grafo, int total_bases, int k) {
+    shared_ptr<LandmarksRuta> alt = make_shared<LandmarksRuta>();
+    alt->filas = grafo.filas;
+    alt->columnas = grafo.columnas;
+    alt->total_bases = total_bases;
+    alt->distancias.resize((size_t)total_bases * k);
+
+    // Esquinas de la matriz; la ultima fila puede estar incompleta
+    int esquinas[4] = {0, grafo.columnas - 1, (grafo.filas - 1) * grafo.columnas, total_bases - 1};
+
+    vector<double> minima(total_bases, HUGE_VAL); // Distancia de cada nodo al landmark mas cercano
+    vector<double> distancia;
+    for (int l = 0; l < k; l++) {
+        int punto = -1;
+        for (int e = 0; e < 4 && punto == -1; e++) {
+            if (esquinas[e] < total_bases && minima[esquinas[e]] > 0.0) punto = esquinas[e];
+        }
+        if (punto == -1) {
+            // Seleccion por el punto mas lejano; hay uno a distancia positiva mientras queden nodos sin elegir
+            double mayor = -1.0;
+            for (int v = 0; v < total_bases; v++) {
+                if (minima[v] > mayor) {
+                    mayor = minima[v];
+                    punto = v;
+                }
+            }
+        }
+
+        distancias_desde(grafo, Posicion(punto / grafo.columnas, punto % grafo.columnas), distancia);
+        double maxima = 0.0;
+        for (int v = 0; v < total_bases; v++) {
+            maxima = max(maxima, distancia[v]);
+            minima[v] = min(minima[v], distancia[v]);
+        }
+        double escala = maxima > 0.0 ? maxima / MAX_CUANTIZADA : 1.0;
+        for (int v = 0; v < total_bases; v++) {
+            double q = floor(distancia[v] / escala);
+            alt->distancias[(size_t)v * k + l] = q > MAX_CUANTIZADA ? MAX_CUANTIZADA : (uint16_t)q;
+        }
+        alt->puntos.push_back(punto);
+        alt->escalas.push_back(escala);
+    }
+    return alt;
+}
+
+static bool guardar_landmarks(const LandmarksRuta& alt, const string& nombreArchivo) {
+    EscritorBinario archivo;
+    if (!archivo.abrir(nombreArchivo)) {
+        return false;
+    }
+    archivo.escribir_u32(MAGIA_ALT);
+    archivo.escribir_u8(VERSION_ALT);
+    archivo.escribir_u32(alt.filas);
+    archivo.escribir_u32(alt.columnas);
+    archivo.escribir_u64(alt.total_bases);
+    archivo.escribir_u64(alt.huella);
+    archivo.escribir_u32(alt.cantidad());
+    for (int l = 0; l < alt.cantidad(); l++) {
+        uint64_t bits;
+        memcpy(&bits, &alt.escalas[l], sizeof(bits));
+        archivo.escribir_u32(alt.puntos[l]);
+        archivo.escribir_u64(bits);
+    }
+    for (size_t i = 0; i < alt.distancias.size(); i++) {
+        archivo.escribir_u16(alt.distancias[i]);
+    }
+    return archivo.cerrar();
+}
+
+// Lee un archivo .alt; devuelve nulo si no existe, esta danado o no corresponde a este grafo y huella
+static shared_ptr<LandmarksRuta> cargar_landmarks(const string& nombreArchivo, const GrafoSecuencia& grafo,
+                                                  uint64_t total_bases, uint64_t huella) {
+    LectorBinario archivo;
+    if (!archivo.abrir(nombreArchivo)) {
+        return nullptr;
+    }
+
+    shared_ptr<LandmarksRuta> alt = make_shared<LandmarksRuta>();
+    uint32_t magia, filas, columnas, k;
+    uint8_t version;
+    if (!archivo.leer_u32(magia) || magia != MAGIA_ALT || !archivo.leer_u8(version) || version != VERSION_ALT ||
+        !archivo.leer_u32(filas) || !archivo.leer_u32(columnas) || !archivo.leer_u64(alt->total_bases) ||
+        !archivo.leer_u64(alt->huella) || !archivo.leer_u32(k)) {
+        return nullptr;
+    }
+    if ((int)filas != grafo.filas || (int)columnas != grafo.columnas || alt->total_bases != total_bases ||
+        alt->huella != huella || k == 0 || k > (uint32_t)MAX_LANDMARKS) {
+        return nullptr;
+    }
+    alt->filas = filas;
+    alt->columnas = columnas;
+
+    for (uint32_t l = 0; l < k; l++) {
+        uint32_t punto;
+        uint64_t bits;
+        double escala;
+        if (!archivo.leer_u32(punto) || !archivo.leer_u64(bits) || punto >= total_bases) {
+            return nullptr;
+        }
+        memcpy(&escala, &bits, sizeof(escala));
+        alt->puntos.push_back(punto);
+        alt->escalas.push_back(escala);
+    }
+
+    if (archivo.restantes() != total_bases * k * 2) {
+        return nullptr;
+    }
+    alt->distancias.resize(total_bases * k);
+    for (size_t i = 0; i < alt->distancias.size(); i++) {
+        if (!archivo.leer_u16(alt->distancias[i])) {
+            return nullptr;
+        }
+    }
+    return alt;
+}
+
+// Landmarks en memoria por descripcion. Cada entrada recuerda las bases para las que vale: las bases
+// son inmutables, asi que mientras sean las mismas (mismo puntero vivo) los landmarks siguen vigentes.
+// Una entrada sin datos recuerda que el archivo de cache no sirve para esas bases
+struct EntradaLandmarks {
+    weak_ptr<const BasesSecuencia> bases;
+    shared_ptr<const LandmarksRuta> datos;
+};
+
+static mutex candado_landmarks;
+static map<string, EntradaLandmarks> registro_landmarks;
+
+static void registrar_landmarks(const string& descripcion, const Bases& bases, shared_ptr<const LandmarksRuta> datos) {
+    lock_guard<mutex> bloqueo(candado_landmarks);
+    EntradaLandmarks& entrada = registro_landmarks[descripcion];
+    entrada.bases = bases;
+    entrada.datos = datos;
+}
+
+shared_ptr<const LandmarksRuta> landmarks_de(const string& descripcion, const Bases& bases, const GrafoSecuencia& grafo) {
+    {
+        lock_guard<mutex> bloqueo(candado_landmarks);
+        map<string, EntradaLandmarks>::iterator it = registro_landmarks.find(descripcion);
+        if (it != registro_landmarks.end() && it->second.bases.lock() == bases) {
+            return it->second.datos;
+        }
+    }
+
+    string nombreArchivo = archivo_landmarks(descripcion);
+    struct stat info;
+    if (stat(nombreArchivo.c_str(), &info) != 0) {
+        registrar_landmarks(descripcion, bases, nullptr); // Sin cache en disco; no se vuelve a buscar para estas bases
+        return nullptr;
+    }
+    shared_ptr<const LandmarksRuta> datos = cargar_landmarks(nombreArchivo, grafo, bases->texto.size(),
+                                                             huella_bases(bases->texto, grafo.columnas));
+    registrar_landmarks(descripcion, bases, datos);
+    return datos;
+}
+
+// Comando: preprocesar_rutas
+void preprocesar_rutas(string descripcion, string num_str) {
+    // Verificar que hay secuencias cargadas
+    Instantanea version = instantanea();
+    if (version->secuencias.empty()) {
+        salida() << "No hay secuencias cargadas en memoria.\n";
+        return;
+    }
+
+    // Buscar la secuencia
+    int indice = version->buscar(descripcion);
+    if (indice == -1) {
+        salida() << "La secuencia " << descripcion << " no existe.\n";
+        return;
+    }
+    const Secuencia& sec = version->secuencias[indice];
+    Bases bases = bases_de(sec);
+
+    int k;
+    try {
+        k = stoi(num_str);
+    } catch (...) {
+        k = 0;
+    }
+    if (k < 1 || k > MAX_LANDMARKS) {
+        salida() << "Error: La cantidad de landmarks debe estar entre 1 y " << MAX_LANDMARKS << ".\n";
+        return;
+    }
+    if (bases->texto.empty()) {
+        salida() << "La secuencia " << descripcion << " no tiene bases.\n";
+        return;
+    }
+    if ((size_t)k > bases->texto.size()) k = bases->texto.size();
+
+    GrafoSecuencia grafo = construir_grafo(bases->texto, sec.ancho_linea);
+    shared_ptr<LandmarksRuta> alt = calcular_landmarks(grafo, bases->texto.size(), k);
+    alt->huella = huella_bases(bases->texto, grafo.columnas);
+    registrar_landmarks(descripcion, bases, alt);
+
+    string nombreArchivo = archivo_landmarks(descripcion);
+    salida() << "Se calcularon " << k << " landmarks para la secuencia " << descripcion << " (";
+    for (int l = 0; l < k; l++) {
+        if (l > 0) salida() << " ";
+        salida() << "[" << alt->puntos[l] / grafo.columnas << "," << alt->puntos[l] % grafo.columnas << "]";
+    }
+    salida() << ").\n";
+    if (guardar_landmarks(*alt, nombreArchivo)) {
+        salida() << "Las distancias se guardaron en " << nombreArchivo << ".\n";
+    } else {
+        salida() << "No se pudieron guardar las distancias en " << nombreArchivo << "; solo quedan en memoria.\n";
+    }
+}
@@ -0,0 +1,72 @@
+#ifndef LANDMARKS_H
+#define LANDMARKS_H
+
+#include "grafo.h"
+#include "secuencias.h"
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <cstdlib>
+
+using namespace std;
+
+const int MAX_LANDMARKS = 32;
+const uint16_t MAX_CUANTIZADA = 65534; // Distancia cuantizada mas grande (la maxima de cada landmark)
+
+// Landmarks de una secuencia para las cotas ALT (A*, Landmarks y desigualdad triangular).
+// Por cada landmark L y cada nodo v se guarda d(L, v) cuantizada a 16 bits: q = floor(d / escala),
+// de modo que d queda en [q * escala, (q + 1) * escala). Las distancias se intercalan por nodo
+// (las de los K landmarks de un nodo estan juntas) porque la busqueda las consulta nodo a nodo
+struct LandmarksRuta {
+    int filas;
+    int columnas;
+    uint64_t total_bases;
+    uint64_t huella;              // Huella de las bases y el ancho de linea con que se calcularon
+    vector<int> puntos;           // Indice fila-mayor de cada landmark
+    vector<double> escalas;       // Escala de cuantizacion de cada landmark
+    vector<uint16_t> distancias;  // total_bases * K
+
+    int cantidad() const { return puntos.size(); }
+};
+
+// Cota inferior de la distancia de cada nodo al destino de una consulta:
+// d(v, t) >= |d(L, t) - d(L, v)| para todo landmark L, porque los pesos son simetricos.
+// Con las distancias cuantizadas se descuenta un paso de escala para que la cota nunca sobreestime
+class CotasRuta {
+public:
+    CotasRuta(const LandmarksRuta* alt, int destino);
+
+    double cota(int nodo) const {
+        if (num == 0) return 0.0;
+        const uint16_t* q = &alt->distancias[(size_t)nodo * num];
+        double mejor = 0.0;
+        for (int l = 0; l < num; l++) {
+            int pasos = abs((int)q[l] - objetivo[l]) - 1;
+            if (pasos > 0 && pasos * alt->escalas[l] > mejor) {
+                mejor = pasos * alt->escalas[l];
+            }
+        }
+        return mejor * (1.0 - 1e-9); // Margen para el redondeo de punto flotante
+    }
+
+private:
+    const LandmarksRuta* alt;
+    int num;                      // 0 si no hay landmarks o no hay destino: la cota es siempre 0
+    int objetivo[MAX_LANDMARKS];  // Distancias cuantizadas del destino a cada landmark
+};
+
+// Huella FNV-1a de las bases y el ancho de linea: si cualquiera cambia, los datos precalculados
+// sobre el grafo (landmarks, resultados de base_remota_todas) ya no sirven
+uint64_t huella_bases(const string& texto, int ancho_linea);
+
+// Landmarks vigentes para las bases de una secuencia: primero los de memoria y, si no hay,
+// los del archivo de cache en disco. Devuelve nulo si no hay o si fueron calculados para otras bases
+shared_ptr<const LandmarksRuta> landmarks_de(const string& descripcion, const Bases& bases, const GrafoSecuencia& grafo);
+
+// Comando: preprocesar_rutas <desc> <num_landmarks>
+// Elige los landmarks (las esquinas de la matriz y luego, uno a uno, el nodo mas lejano a los ya elegidos),
+// calcula sus distancias y las deja en memoria y en el archivo <desc>.alt para las siguientes sesiones
+void preprocesar_rutas(string descripcion, string num_str);
+
+#endif
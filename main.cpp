@@ -1,15 +1,10 @@
-#include "secuencias.h"
-#include "interfaz.h"
-#include "huffman.h"
-#include "grafo.h"
+#include "comandos.h"
 #include <iostream>
 
 using namespace std;
 
 int main() {
     string input;                  // Línea completa que escribe el usuario
-    string partes[MAX_PARTES];    // Partes del comando separadas
-    int numPartes;                // Número real de partes del comando
 
     // Mensaje inicial
     cout << "Bienvenido al sistema de manipulacion de secuencias geneticas.\n";
@@ -18,71 +13,11 @@ int main() {
     // Bucle principal de la consola
     while (true) {
         cout << "$ ";              // Indicador de línea de comandos
-        getline(cin, input);       // Leer la línea completa que escribe el usuario
+        if (!getline(cin, input)) break; // Fin de la entrada (por ejemplo, comandos desde un archivo o tuberia)
 
         if (input.empty()) continue;  // Ignorar líneas vacías
 
-        numPartes = dividir(input, partes); // Separar el comando en partes
-        string comando = partes[0];         // Primer palabra = nombre del comando
-
-        // Comando para salir del programa
-        if (comando == "salir") {
-            break;
-
-        // Comando de ayuda general o específica
-        } else if (comando == "ayuda") {
-            if (numPartes == 1) {
-                mostrar_ayuda_general();
-            } else {
-                mostrar_ayuda_comando(partes[1]);
-            }
-
-        // Comandos del Componente 1: Resumen de la información de un genoma
-        } else if (comando == "cargar") {
-            if (numPartes != 2) cout << "Error: Uso correcto -> cargar <archivo>\n";
-            else cargar_archivo(partes[1]);
-
-        } else if (comando == "listar_secuencias") {
-            listar_secuencias();
-
-        } else if (comando == "histograma") {
-            if (numPartes != 2) cout << "Error: Uso correcto -> histograma <descripcion>\n";
-            else histograma(partes[1]);
-
-        } else if (comando == "es_subsecuencia") {
-            if (numPartes != 2) cout << "Error: Uso correcto -> es_subsecuencia <sub>\n";
-            else subsecuencia(partes[1]);
-
-        } else if (comando == "enmascarar") {
-            if (numPartes != 2) cout << "Error: Uso correcto -> enmascarar <sub>\n";
-            else enmascarar(partes[1]);
-
-        } else if (comando == "guardar") {
-            if (numPartes != 2) cout << "Error: Uso correcto -> guardar <archivo>\n";
-            else guardar_archivo(partes[1]);
-
-        // Comandos del Componente 2: Codificación y decodificación Huffman
-        } else if (comando == "codificar") {
-            if (numPartes != 2) cout << "Error: Uso correcto -> codificar <archivo.fabin>\n";
-            else codificar(partes[1]);
-
-        } else if (comando == "decodificar") {
-            if (numPartes != 2) cout << "Error: Uso correcto -> decodificar <archivo.fabin>\n";
-            else decodificar(partes[1]);
-            
-        // Comandos del Componente 3: Grafos y rutas
-        } else if (comando == "ruta_mas_corta") {
-            if (numPartes != 6) cout << "Error: Uso correcto -> ruta_mas_corta <desc> <i> <j> <x> <y>\n";
-            else ruta_mas_corta(partes[1], partes[2], partes[3], partes[4], partes[5]);
-
-        } else if (comando == "base_remota") {
-            if (numPartes != 4) cout << "Error: Uso correcto -> base_remota <desc> <i> <j>\n";
-            else base_remota(partes[1], partes[2], partes[3]);
-
-        // Cualquier otro comando que no se reconozca
-        } else {
-            cerr << "Error: Comando no reconocido. Escribe 'ayuda' para ver los comandos válidos.\n";
-        }
+        if (!ejecutar_comando(input)) break;
     }
 
     // Fin del programa
@@ -0,0 +1,226 @@
+#include "perfil.h"
+#include "interfaz.h"
+#include <iostream>
+#include <iomanip>
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+using namespace std;
+
+static const char* nombres_contadores[NUM_CONTADORES] = {
+    "bytes_leidos", "bases_codificadas", "bytes_codificados", "bases_decodificadas",
+    "posiciones_probadas", "salidas_tempranas", "nodos_asentados", "aristas_relajadas"
+};
+
+// Acumulado de todas las ejecuciones de un comando
+struct EstadisticaComando {
+    uint64_t llamadas;
+    double tiempo_total_ms;
+    double tiempo_max_ms;
+    uint64_t solapadas;          // Ejecuciones que coincidieron con otro comando: no suman lo que sigue
+    uint64_t pico_memoria;       // Mayor memoria reservada por una ejecucion sobre la que habia al empezar (bytes)
+    uint64_t reservas;           // Llamadas a new en todas las ejecuciones
+    uint64_t reservas_ultima;    // Llamadas a new en la ultima ejecucion
+    uint64_t contadores[NUM_CONTADORES];
+};
+
+static atomic<uint64_t> contadores[NUM_CONTADORES];
+static map<string, EstadisticaComando> estadisticas;
+static mutex mutex_estadisticas;
+
+void perfil_sumar(ContadorPerfil contador, uint64_t n) {
+    contadores[contador].fetch_add(n, memory_order_relaxed);
+}
+
+// Los contadores, la memoria y las reservas son del proceso entero (los comandos los suman tambien desde
+// sus hilos de trabajo), asi que una ejecucion solo se atribuye lo medido si ningun otro comando corrio
+// a la vez. Con el servidor los comandos pueden solaparse: esas ejecuciones solo suman tiempo y llamadas
+static atomic<int> comandos_en_curso(0);
+static atomic<uint64_t> solapes(0); // Aumenta cada vez que un comando empieza mientras otro sigue en curso
+
+#ifdef PERFILAR
+// Con el perfilado activo, new/delete llevan la cuenta de los bytes reservados y de las reservas hechas.
+// Cada bloque guarda su tamaño en una cabecera de 16 bytes (mantiene la alineacion de malloc)
+static atomic<uint64_t> memoria_actual(0);
+static atomic<uint64_t> memoria_pico(0);
+static atomic<uint64_t> reservas_totales(0);
+const size_t CABECERA_RESERVA = 16;
+
+static void* reservar_contando(size_t n) {
+    void* bloque = malloc(n + CABECERA_RESERVA);
+    if (bloque == nullptr) throw bad_alloc();
+    *static_cast<size_t*>(bloque) = n;
+    reservas_totales.fetch_add(1, memory_order_relaxed);
+    uint64_t actual = memoria_actual.fetch_add(n, memory_order_relaxed) + n;
+    uint64_t pico = memoria_pico.load(memory_order_relaxed);
+    while (actual > pico && !memoria_pico.compare_exchange_weak(pico, actual, memory_order_relaxed)) {
+    }
+    return static_cast<char*>(bloque) + CABECERA_RESERVA;
+}
+
+static void liberar_contando(void* p) {
+    if (p == nullptr) return;
+    char* bloque = static_cast<char*>(p) - CABECERA_RESERVA;
+    memoria_actual.fetch_sub(*reinterpret_cast<size_t*>(bloque), memory_order_relaxed);
+    free(bloque);
+}
+
+void* operator new(size_t n) { return reservar_contando(n); }
+void* operator new[](size_t n) { return reservar_contando(n); }
+void operator delete(void* p) noexcept { liberar_contando(p); }
+void operator delete[](void* p) noexcept { liberar_contando(p); }
+#endif
+
+MedicionComando::MedicionComando(const string& nombre, bool envolvente)
+    : nombre(nombre), inicio(chrono::steady_clock::now()), envolvente(envolvente) {
+    solapada = envolvente || comandos_en_curso.fetch_add(1) > 0;
+    if (solapada && !envolvente) solapes.fetch_add(1);
+    solapes_inicio = solapes.load();
+    for (int c = 0; c < NUM_CONTADORES; c++) {
+        contadores_inicio[c] = contadores[c].load(memory_order_relaxed);
+    }
+    memoria_inicio = 0;
+    reservas_inicio = 0;
+#ifdef PERFILAR
+    memoria_inicio = memoria_actual.load(memory_order_relaxed);
+    if (!solapada) memoria_pico.store(memoria_inicio, memory_order_relaxed); // Otro comando usa el pico en curso
+    reservas_inicio = reservas_totales.load(memory_order_relaxed);
+#endif
+}
+
+MedicionComando::~MedicionComando() {
+    double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - inicio).count();
+#ifdef PERFILAR
+    // Antes de tocar el mapa, que reserva memoria la primera vez que aparece un comando
+    uint64_t reservas = reservas_totales.load(memory_order_relaxed) - reservas_inicio;
+    uint64_t pico = memoria_pico.load(memory_order_relaxed) - memoria_inicio;
+#endif
+    uint64_t medidos[NUM_CONTADORES];
+    for (int c = 0; c < NUM_CONTADORES; c++) {
+        medidos[c] = contadores[c].load(memory_order_relaxed) - contadores_inicio[c];
+    }
+    if (solapes.load() != solapes_inicio) solapada = true; // Otro comando empezo mientras este corria
+    if (!envolvente) comandos_en_curso.fetch_sub(1);
+
+    lock_guard<mutex> bloqueo(mutex_estadisticas);
+    map<string, EstadisticaComando>::iterator it = estadisticas.find(nombre);
+    if (it == estadisticas.end()) {
+        it = estadisticas.insert(make_pair(nombre, EstadisticaComando())).first;
+    }
+    EstadisticaComando& e = it->second;
+    e.llamadas++;
+    e.tiempo_total_ms += ms;
+    if (ms > e.tiempo_max_ms) e.tiempo_max_ms = ms;
+    if (solapada) {
+        e.solapadas++;
+        return;
+    }
+    for (int c = 0; c < NUM_CONTADORES; c++) {
+        e.contadores[c] += medidos[c];
+    }
+#ifdef PERFILAR
+    if (pico > e.pico_memoria) e.pico_memoria = pico;
+    e.reservas += reservas;
+    e.reservas_ultima = reservas;
+#endif
+}
+
+static void imprimir_tabla() {
+    salida() << left << setw(22) << "comando" << right << setw(9) << "llamadas" << setw(14) << "total_ms"
+         << setw(12) << "max_ms";
+#ifdef PERFILAR
+    salida() << setw(11) << "solapadas" << setw(16) << "pico_memoria" << setw(12) << "reservas" << setw(10) << "ultima";
+#endif
+    salida() << "\n";
+
+    salida() << fixed << setprecision(3);
+    for (map<string, EstadisticaComando>::const_iterator it = estadisticas.begin(); it != estadisticas.end(); ++it) {
+        const EstadisticaComando& e = it->second;
+        salida() << left << setw(22) << it->first << right << setw(9) << e.llamadas << setw(14) << e.tiempo_total_ms
+             << setw(12) << e.tiempo_max_ms;
+#ifdef PERFILAR
+        salida() << setw(11) << e.solapadas << setw(16) << e.pico_memoria << setw(12) << e.reservas
+                 << setw(10) << e.reservas_ultima;
+#endif
+        salida() << "\n";
+#ifdef PERFILAR
+        for (int c = 0; c < NUM_CONTADORES; c++) {
+            if (e.contadores[c] > 0) {
+                salida() << "    " << left << setw(22) << nombres_contadores[c] << right << e.contadores[c] << "\n";
+            }
+        }
+#endif
+    }
+    salida().unsetf(ios::floatfield);
+    salida() << setprecision(6);
+}
+
+// Escribe una cadena JSON entre comillas, escapando las comillas, las barras y los caracteres de control
+static void escribir_cadena_json(const string& texto) {
+    salida() << '"';
+    for (size_t i = 0; i < texto.size(); i++) {
+        unsigned char c = texto[i];
+        if (c == '"' || c == '\\') {
+            salida() << '\\' << (char)c;
+        } else if (c < 0x20) {
+            static const char hex[] = "0123456789abcdef";
+            salida() << "\\u00" << hex[c >> 4] << hex[c & 15];
+        } else {
+            salida() << (char)c;
+        }
+    }
+    salida() << '"';
+}
+
+static void imprimir_json() {
+    salida() << "{\"perfilado\": " <<
+#ifdef PERFILAR
+        "true"
+#else
+        "false"
+#endif
+        << ", \"comandos\": [";
+    bool primero = true;
+    for (map<string, EstadisticaComando>::const_iterator it = estadisticas.begin(); it != estadisticas.end(); ++it) {
+        const EstadisticaComando& e = it->second;
+        salida() << (primero ? "" : ", ") << "{\"nombre\": ";
+        escribir_cadena_json(it->first);
+        salida() << ", \"llamadas\": " << e.llamadas
+             << ", \"tiempo_total_ms\": " << e.tiempo_total_ms << ", \"tiempo_max_ms\": " << e.tiempo_max_ms
+             << ", \"solapadas\": " << e.solapadas << ", \"pico_memoria\": " << e.pico_memoria << ", \"reservas\": " << e.reservas
+             << ", \"reservas_ultima\": " << e.reservas_ultima << ", \"contadores\": {";
+        for (int c = 0; c < NUM_CONTADORES; c++) {
+            salida() << (c == 0 ? "" : ", ");
+            escribir_cadena_json(nombres_contadores[c]);
+            salida() << ": " << e.contadores[c];
+        }
+        salida() << "}}";
+        primero = false;
+    }
+    salida() << "]}\n";
+}
+
+// Comando: perfil
+void perfil(string formato) {
+    lock_guard<mutex> bloqueo(mutex_estadisticas);
+    if (formato == "reiniciar") {
+        estadisticas.clear();
+        salida() << "Estadisticas de perfil reiniciadas.\n";
+        return;
+    }
+    if (estadisticas.empty()) {
+        salida() << "No hay comandos medidos.\n";
+        return;
+    }
+    if (formato == "json") {
+        imprimir_json();
+    } else {
+        imprimir_tabla();
+#ifndef PERFILAR
+        salida() << "(Solo tiempos; compilar con 'make PERFIL=1' para contadores y memoria.)\n";
+#endif
+    }
+}
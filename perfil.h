@@ -0,0 +1,58 @@
+#ifndef PERFIL_H
+#define PERFIL_H
+
+#include <string>
+#include <cstdint>
+#include <chrono>
+
+using namespace std;
+
+// Instrumentacion de las rutas criticas. Se activa al compilar con -DPERFILAR (make PERFIL=1);
+// sin esa bandera las macros no generan codigo y la medicion por comando solo toma el tiempo de pared
+
+// Contadores de trabajo realizado
+enum ContadorPerfil {
+    BYTES_LEIDOS,           // Bytes de FASTA analizados por cargar/cargar_agregar
+    BASES_CODIFICADAS,      // Bases recorridas por codificar
+    BYTES_CODIFICADOS,      // Bytes escritos en el .fabin
+    BASES_DECODIFICADAS,    // Bases producidas por decodificar
+    POSICIONES_PROBADAS,    // Posiciones de inicio decididas por los buscadores de subsecuencias
+    SALIDAS_TEMPRANAS,      // Candidatas cortadas en su primer caracter incompatible (solo los recorridos
+                            // posicion por posicion; los de bits no comparan candidata por candidata)
+    NODOS_ASENTADOS,        // Nodos extraidos con distancia definitiva en las busquedas de rutas
+    ARISTAS_RELAJADAS,      // Aristas que mejoraron una distancia
+    NUM_CONTADORES
+};
+
+#ifdef PERFILAR
+#define PERFIL_SUMAR(contador, n) perfil_sumar((contador), (n))
+#else
+#define PERFIL_SUMAR(contador, n) ((void)sizeof(n)) // No evalua n; solo evita avisos de variables sin uso
+#endif
+
+void perfil_sumar(ContadorPerfil contador, uint64_t n);
+
+// Mide un comando desde su construccion hasta su destruccion y acumula el resultado bajo su nombre.
+// Los contadores y la memoria solo se atribuyen si ningun otro comando corrio a la vez; si no,
+// la ejecucion se cuenta como solapada y solo aporta su tiempo. Un comando 'envolvente' (servidor)
+// ejecuta otros dentro: no cuenta para sus solapes y nunca se atribuye sus contadores
+class MedicionComando {
+public:
+    MedicionComando(const string& nombre, bool envolvente = false);
+    ~MedicionComando();
+
+private:
+    const string& nombre; // Sin copia: el nombre vive en las partes del comando hasta que termina
+    chrono::steady_clock::time_point inicio;
+    uint64_t contadores_inicio[NUM_CONTADORES];
+    uint64_t memoria_inicio;
+    uint64_t reservas_inicio;
+    uint64_t solapes_inicio;
+    bool envolvente;
+    bool solapada;
+};
+
+// Comando: perfil [json|reiniciar]
+void perfil(string formato = "");
+
+#endif
@@ -0,0 +1,56 @@
+#ifndef PROTOCOLO_H
+#define PROTOCOLO_H
+
+#include <string>
+#include <cstdint>
+#include <cerrno>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace std;
+
+// Protocolo entre el servidor y el cliente sobre un socket UNIX local.
+// Cada mensaje es su longitud (4 bytes, little-endian) seguida de sus bytes. El cliente envia una
+// linea de comando y el servidor responde con todo lo que el comando escribio en salida()
+const uint32_t MAX_PETICION = 1 << 20; // Una linea de comando nunca se acerca a este tamaño
+
+inline bool leer_completo(int fd, char* datos, size_t n) {
+    while (n > 0) {
+        ssize_t leidos = read(fd, datos, n);
+        if (leidos < 0 && errno == EINTR) continue;
+        if (leidos <= 0) return false; // Error o conexion cerrada
+        datos += leidos;
+        n -= leidos;
+    }
+    return true;
+}
+
+inline bool escribir_completo(int fd, const char* datos, size_t n) {
+    while (n > 0) {
+        // MSG_NOSIGNAL: si el otro extremo cerro, send falla en lugar de terminar el proceso con SIGPIPE
+        ssize_t escritos = send(fd, datos, n, MSG_NOSIGNAL);
+        if (escritos < 0 && errno == EINTR) continue;
+        if (escritos <= 0) return false;
+        datos += escritos;
+        n -= escritos;
+    }
+    return true;
+}
+
+inline bool enviar_mensaje(int fd, const string& mensaje) {
+    uint32_t n = mensaje.size();
+    char largo[4] = {(char)(n & 0xff), (char)((n >> 8) & 0xff), (char)((n >> 16) & 0xff), (char)(n >> 24)};
+    return escribir_completo(fd, largo, 4) && escribir_completo(fd, mensaje.data(), mensaje.size());
+}
+
+// Devuelve false si la conexion se cerro, hubo un error o el mensaje supera 'maximo'
+inline bool recibir_mensaje(int fd, string& mensaje, uint32_t maximo) {
+    unsigned char largo[4];
+    if (!leer_completo(fd, reinterpret_cast<char*>(largo), 4)) return false;
+    uint32_t n = largo[0] | (largo[1] << 8) | (largo[2] << 16) | ((uint32_t)largo[3] << 24);
+    if (n > maximo) return false;
+    mensaje.resize(n);
+    return n == 0 || leer_completo(fd, &mensaje[0], n);
+}
+
+#endif
@@ -1,179 +1,419 @@
 #include "secuencias.h"
+#include "binario.h"
+#include "bgzf.h"
+#include "perfil.h"
+#include "iupac.h"
+#include "busqueda.h"
+#include "interfaz.h"
+#include "sesion.h"
+#include <cctype>
+#include <cstring>
+#include <cstdio>
+#include <algorithm>
+#include <thread>
+#include <unordered_map>
+
+// Version publicada del conjunto de secuencias. Se lee y se reemplaza con las operaciones atomicas
+// de shared_ptr, asi que una lectura nunca ve una version a medio armar
+static shared_ptr<const VersionSecuencias> version_vigente = make_shared<VersionSecuencias>();
+static mutex candado_escritura; // Ordena las ediciones entre si
+static uint64_t ultima_version = 0; // Protegido por candado_escritura
+
+const size_t TAM_BUFFER_SALIDA = 1 << 20; // 1 MiB por escritura al disco
+
+// Escritor de texto con buffer: acumula la salida y la vuelca en bloques grandes
+// en lugar de pasar cada campo por el operador << del stream. El buffer es el de la sesion,
+// que se reserva con la primera escritura y se conserva para las siguientes
+class EscritorBuffer {
+public:
+    EscritorBuffer(ostream& destino) : destino(destino), usados(0) {
+        vector<char>& memoria = memoria_sesion().buffer_salida;
+        memoria.resize(TAM_BUFFER_SALIDA);
+        buffer = memoria.data();
+    }
 
-// Definición de la variable global
-vector<Secuencia> secuencias;
+    ~EscritorBuffer() {
+        vaciar();
+    }
 
-// Función auxiliar para verificar si un carácter es válido según la Tabla 1
-bool es_base_valida(char base) {
-    string bases_validas = "ACGTURYKMSWBDHVNX-";
-    for (int i = 0; i < bases_validas.size(); i++) {
-        if (base == bases_validas[i]) {
-            return true;
+    void escribir(const char* datos, size_t n) {
+        // Bloques más grandes que el buffer se escriben directamente
+        if (n >= TAM_BUFFER_SALIDA) {
+            vaciar();
+            destino.write(datos, n);
+            return;
+        }
+        if (usados + n > TAM_BUFFER_SALIDA) {
+            vaciar();
         }
+        memcpy(buffer + usados, datos, n);
+        usados += n;
     }
-    return false;
+
+    void escribir(const string& texto) {
+        escribir(texto.data(), texto.size());
+    }
+
+    void escribir(const char* texto) {
+        escribir(texto, strlen(texto));
+    }
+
+    void escribir(char c) {
+        if (usados == TAM_BUFFER_SALIDA) {
+            vaciar();
+        }
+        buffer[usados++] = c;
+    }
+
+    // Escribe un entero sin signo en decimal sin pasar por el stream
+    void escribir_numero(uint64_t valor) {
+        char digitos[20];
+        int n = 0;
+        do {
+            digitos[n++] = '0' + (valor % 10);
+            valor /= 10;
+        } while (valor > 0);
+        while (n > 0) {
+            escribir(digitos[--n]);
+        }
+    }
+
+    void vaciar() {
+        if (usados > 0) {
+            destino.write(buffer, usados);
+            usados = 0;
+        }
+    }
+
+    bool correcto() const {
+        return destino.good();
+    }
+
+private:
+    ostream& destino;
+    char* buffer;
+    size_t usados;
+};
+
+// Función auxiliar para verificar si un carácter es válido según la Tabla 1
+bool es_base_valida(char base) {
+    return TABLA_VALIDAS[(unsigned char)base] != 0;
 }
 
-// Función auxiliar para obtener el número mínimo de bases que representa un código
+// Función auxiliar para obtener el número mínimo de bases que representa un código ('-' y caracteres no válidos no cuentan)
 int obtener_bases_minimas(char codigo) {
-    switch (codigo) {
-        case 'A': case 'C': case 'G': case 'T': case 'U': case 'X':
-            return 1;  // Bases específicas y máscara
-        case 'R': case 'Y': case 'K': case 'M': case 'S': case 'W':
-            return 1;  // Códigos ambiguos de 2 bases, representan 1 posición
-        case 'B': case 'D': case 'H': case 'V':
-            return 1;  // Códigos ambiguos de 3 bases, representan 1 posición
-        case 'N':
-            return 1;  // Código ambiguo de todas las bases, representa 1 posición
-        case '-':
-            return 0;  // Espacio de longitud indeterminada no cuenta
-        default:
-            return 0;  // Carácter no válido
-    }
+    return TABLA_BASES_MINIMAS[(unsigned char)codigo];
 }
 
-// Función para verificar si un código de secuencia puede coincidir con un código literal de subsecuencia
+// Función para verificar si un código de secuencia puede coincidir con un código literal de subsecuencia.
+// La subsecuencia se trata como LITERAL: el código de secuencia (que puede ser ambiguo) debe poder representarlo;
+// la máscara X coincide con cualquier cosa y los espacios '-' solo con espacios (ver iupac.h)
 bool son_compatibles(char codigo_secuencia, char codigo_subsecuencia) {
-    // Si son iguales, siempre son compatibles
-    if (codigo_secuencia == codigo_subsecuencia) {
-        return true;
-    }
-    
-    // La máscara X en la secuencia coincide con cualquier cosa
-    if (codigo_secuencia == 'X') {
-        return true;
-    }
-    
-    // Los espacios solo coinciden con espacios
-    if (codigo_secuencia == '-' || codigo_subsecuencia == '-') {
-        return codigo_secuencia == codigo_subsecuencia;
-    }
-    
-    // Si la subsecuencia tiene X, coincide con cualquier cosa
-    if (codigo_subsecuencia == 'X') {
-        return true;
-    }
-    
-    // REGLA CLAVE: La subsecuencia se trata como LITERAL
-    // Solo verificamos si el código de secuencia (que puede ser ambiguo)
-    // puede representar el código literal de la subsecuencia
-    
-    // Obtener las bases que puede representar el código de SECUENCIA
-    string bases_secuencia = "";
-    
-    switch (codigo_secuencia) {
-        case 'A': bases_secuencia = "A"; break;
-        case 'C': bases_secuencia = "C"; break;
-        case 'G': bases_secuencia = "G"; break;
-        case 'T': bases_secuencia = "T"; break;
-        case 'U': bases_secuencia = "U"; break;
-        case 'R': bases_secuencia = "AG"; break;        // A o G
-        case 'Y': bases_secuencia = "CTU"; break;       // C, T o U
-        case 'K': bases_secuencia = "GTU"; break;       // G, T o U
-        case 'M': bases_secuencia = "AC"; break;        // A o C
-        case 'S': bases_secuencia = "CG"; break;        // C o G
-        case 'W': bases_secuencia = "ATU"; break;       // A, T o U
-        case 'B': bases_secuencia = "CGTU"; break;      // C, G, T o U
-        case 'D': bases_secuencia = "AGTU"; break;      // A, G, T o U
-        case 'H': bases_secuencia = "ACTU"; break;      // A, C, T o U
-        case 'V': bases_secuencia = "ACG"; break;       // A, C o G
-        case 'N': bases_secuencia = "ACGTU"; break;     // A, C, G, T o U
-        default: return false;
-    }
-    
-    // Verificar si el código LITERAL de la subsecuencia está en las bases 
-    // que puede representar el código de secuencia
-    for (int i = 0; i < bases_secuencia.size(); i++) {
-        if (bases_secuencia[i] == codigo_subsecuencia) {
-            return true;
+    return iupac_compatibles(codigo_secuencia, codigo_subsecuencia);
+}
+
+// Analizador de FASTA por tramos: recibe el archivo en bloques de bytes de cualquier tamaño
+// (lectura directa o salida de un descompresor) y arma las secuencias a medida que avanzan las lineas
+class LectorFasta {
+public:
+    LectorFasta(vector<Secuencia>& destino, bool suave) : destino(destino), tabla(TABLA_FILTRO.valor), suave(suave) {
+        reiniciar_secuencia();
+    }
+
+    void alimentar(const uint8_t* datos, size_t n) {
+        const char* texto = reinterpret_cast<const char*>(datos);
+        while (n > 0) {
+            const char* fin = static_cast<const char*>(memchr(texto, '\n', n));
+            if (fin == nullptr) {
+                pendiente.append(texto, n); // Linea incompleta: se completa con el siguiente tramo
+                return;
+            }
+            size_t largo = fin - texto;
+            if (pendiente.empty()) {
+                procesar_linea(texto, largo);
+            } else {
+                pendiente.append(texto, largo);
+                procesar_linea(pendiente.data(), pendiente.size());
+                pendiente.clear();
+            }
+            texto += largo + 1;
+            n -= largo + 1;
         }
     }
-    
-    return false; // El código de secuencia no puede representar el código literal
-}
 
-// Función para cargar un archivo FASTA
-void cargar_archivo(string nombreArchivo) {
-    ifstream archivo(nombreArchivo);
-    if (!archivo.is_open()) {
-        cout << nombreArchivo << " no se encuentra o no puede leerse.\n";
-        return;
+    // Procesa la ultima linea (si no terminaba en salto de linea) y guarda la ultima secuencia
+    void terminar() {
+        if (!pendiente.empty()) {
+            procesar_linea(pendiente.data(), pendiente.size());
+            pendiente.clear();
+        }
+        guardar_secuencia();
     }
 
-    secuencias.clear(); // Se reemplazan secuencias anteriores
+private:
+    vector<Secuencia>& destino;
+    const uint8_t* tabla; // Caracter en mayuscula si es valido, 0 si se ignora
+    bool suave;           // Recordar las bases en minuscula
+    string pendiente;
+    string descripcion, bases;
+    MascaraSuave mascara;
+    int ancho_linea;
+    bool primera_linea_bases; // Para detectar ancho de la primera línea
+
+    void reiniciar_secuencia() {
+        bases.clear();
+        mascara.clear();
+        ancho_linea = 80; // Valor por defecto
+        primera_linea_bases = true;
+    }
 
-    string linea, descripcion, bases = "";
-    int ancho_linea = 80; // Valor por defecto
-    bool primera_linea_bases = true; // Para detectar ancho de la primera línea
-    
-    while (getline(archivo, linea)) {
+    // Si ya había una secuencia, guardarla antes de iniciar otra
+    void guardar_secuencia() {
+        if (descripcion.empty()) return;
+        destino.push_back(Secuencia());
+        destino.back().descripcion = descripcion;
+        destino.back().bases = crear_bases(bases, mascara);
+        destino.back().ancho_linea = ancho_linea;
+        reiniciar_secuencia();
+    }
 
-        if (linea[0] == '>') {
-            // Si ya había una secuencia, guardarla antes de iniciar otra
-            if (!descripcion.empty()) {
-                secuencias.push_back({descripcion, bases, ancho_linea});
-                bases.clear();
-                primera_linea_bases = true; // Reiniciar para nueva secuencia
-                ancho_linea = 80; // Resetear a default
-            }
-            descripcion = linea.substr(1); // quitar el '>'
-        } 
-        else {
-            // Validar y filtrar caracteres según la Tabla 1
-            string linea_filtrada = "";
-            for (int i = 0; i < linea.size(); i++) {
-                char c = toupper(linea[i]); // Convertir a mayúscula
-                if (es_base_valida(c)) {
-                    linea_filtrada += c;
+    void procesar_linea(const char* linea, size_t largo) {
+        if (largo > 0 && linea[0] == '>') {
+            guardar_secuencia();
+            descripcion.assign(linea + 1, largo - 1); // quitar el '>'
+            return;
+        }
+
+        // Validar y filtrar caracteres según la Tabla 1, convirtiendo a mayúscula;
+        // los caracteres no válidos (espacios, números, etc.) se ignoran
+        size_t antes = bases.size();
+        if (suave) {
+            // Las letras validas que la tabla cambia son las minusculas
+            for (size_t i = 0; i < largo; i++) {
+                char c = tabla[(unsigned char)linea[i]];
+                if (c != 0) {
+                    if (c != linea[i]) extender_mascara(mascara, bases.size(), bases.size() + 1);
+                    bases.push_back(c);
                 }
-                // Ignorar caracteres no válidos (espacios, números, etc.)
             }
-            
-            // Detectar ancho de línea de la primera línea de bases
-            if (primera_linea_bases && !linea_filtrada.empty()) {
-                ancho_linea = linea_filtrada.size();
-                primera_linea_bases = false;
+        } else {
+            for (size_t i = 0; i < largo; i++) {
+                char c = tabla[(unsigned char)linea[i]];
+                if (c != 0) {
+                    bases.push_back(c);
+                }
             }
-            
-            bases += linea_filtrada;
         }
+
+        // Detectar ancho de línea de la primera línea de bases
+        if (primera_linea_bases && bases.size() > antes) {
+            ancho_linea = bases.size() - antes;
+            primera_linea_bases = false;
+        }
+    }
+};
+
+// Lee un archivo FASTA, plano o comprimido con gzip/BGZF, y agrega sus secuencias a 'destino'.
+// Devuelve false si el archivo no se puede abrir o la compresion esta dañada
+static bool leer_fasta(const string& nombreArchivo, vector<Secuencia>& destino, bool suave) {
+    LectorBinario archivo;
+    if (!archivo.abrir(nombreArchivo)) {
+        return false;
     }
 
-    // Guardar la última secuencia si existe
-    if (!descripcion.empty()) {
-        secuencias.push_back({descripcion, bases, ancho_linea});
+    LectorFasta lector(destino, suave);
+    if (es_gzip(archivo)) {
+        // El descompresor entrega los datos directamente al analizador, sin archivo intermedio.
+        // Sus buffers son los de la sesion del hilo (cada hilo de cargar_agregar usa los suyos)
+        if (!descomprimir_gzip(archivo, [&lector](const uint8_t* datos, size_t n) {
+                lector.alimentar(datos, n);
+                PERFIL_SUMAR(BYTES_LEIDOS, n);
+            }, memoria_sesion().bgzf)) {
+            return false;
+        }
+    } else {
+        size_t n;
+        while ((n = archivo.disponibles()) > 0) {
+            lector.alimentar(archivo.actual(), n);
+            archivo.avanzar(n);
+            PERFIL_SUMAR(BYTES_LEIDOS, n);
+        }
     }
+    lector.terminar();
+    return true;
+}
 
-    if (secuencias.empty()) {
-        cout << nombreArchivo << " no contiene ninguna secuencia.\n";
+Bases crear_bases(string& texto) {
+    shared_ptr<string> datos = make_shared<string>();
+    datos->swap(texto);
+    return make_shared<BasesSecuencia>(datos, resumen_alfabeto(datos->data(), datos->size()));
+}
+
+Bases crear_bases(string& texto, MascaraSuave& suave) {
+    shared_ptr<string> datos = make_shared<string>();
+    datos->swap(texto);
+    shared_ptr<BasesSecuencia> bases = make_shared<BasesSecuencia>(datos, resumen_alfabeto(datos->data(), datos->size()));
+    bases->suave.swap(suave);
+    return bases;
+}
+
+Bases cambiar_mascara(const Bases& bases, MascaraSuave& suave) {
+    shared_ptr<BasesSecuencia> nuevas = make_shared<BasesSecuencia>(bases->datos, bases->alfabeto);
+    nuevas->suave.swap(suave);
+    return nuevas;
+}
+
+void extender_mascara(MascaraSuave& mascara, uint64_t inicio, uint64_t fin) {
+    if (!mascara.empty() && inicio <= mascara.back().fin) {
+        mascara.back().fin = max(mascara.back().fin, fin);
+    } else {
+        mascara.push_back({inicio, fin});
+    }
+}
+
+// Une dos mascaras recorriendolas en orden de inicio
+MascaraSuave unir_mascaras(const MascaraSuave& a, const MascaraSuave& b) {
+    MascaraSuave unida;
+    unida.reserve(a.size() + b.size());
+    size_t i = 0, j = 0;
+    while (i < a.size() || j < b.size()) {
+        const IntervaloSuave& siguiente = (j == b.size() || (i < a.size() && a[i].inicio <= b[j].inicio)) ? a[i++] : b[j++];
+        extender_mascara(unida, siguiente.inicio, siguiente.fin);
+    }
+    return unida;
+}
+
+Instantanea instantanea() {
+    return atomic_load(&version_vigente);
+}
+
+EdicionSecuencias::EdicionSecuencias(bool copiar_vigente) : candado(candado_escritura) {
+    // Con el candado tomado nadie mas publica, asi que la version vigente no cambia durante la copia
+    nueva = copiar_vigente ? make_shared<VersionSecuencias>(*instantanea()) : make_shared<VersionSecuencias>();
+}
+
+void EdicionSecuencias::publicar() {
+    nueva->numero = ++ultima_version;
+    atomic_store(&version_vigente, shared_ptr<const VersionSecuencias>(nueva));
+    nueva = make_shared<VersionSecuencias>(*nueva); // Una edicion publicada no se vuelve a modificar
+}
+
+void VersionSecuencias::reconstruir_indice() {
+    indice_nombres.clear();
+    indice_nombres.reserve(secuencias.size());
+    for (size_t i = 0; i < secuencias.size(); i++) {
+        indice_nombres.insert(make_pair(secuencias[i].descripcion, (int)i)); // Conserva la primera aparicion
+    }
+}
+
+// Busca una secuencia por su descripcion; devuelve su posicion o -1 si no existe
+int VersionSecuencias::buscar(const string& descripcion) const {
+    unordered_map<string, int>::const_iterator it = indice_nombres.find(descripcion);
+    return it == indice_nombres.end() ? -1 : it->second;
+}
+
+// Mueve las secuencias nuevas al final de la version, omitiendo las descripciones que ya existen.
+// Devuelve cuantas se omitieron
+int VersionSecuencias::agregar(vector<Secuencia>& nuevas) {
+    int omitidas = 0;
+    secuencias.reserve(secuencias.size() + nuevas.size()); // Una sola realocacion; las existentes se mueven, no se copian
+    for (size_t i = 0; i < nuevas.size(); i++) {
+        if (!indice_nombres.insert(make_pair(nuevas[i].descripcion, (int)secuencias.size())).second) {
+            omitidas++;
+            continue;
+        }
+        secuencias.push_back(move(nuevas[i]));
+    }
+    nuevas.clear();
+    return omitidas;
+}
+
+// Función para cargar un archivo FASTA
+void cargar_archivo(string nombreArchivo, bool suave) {
+    vector<Secuencia> leidas;
+    if (!leer_fasta(nombreArchivo, leidas, suave)) {
+        salida() << nombreArchivo << " no se encuentra o no puede leerse.\n";
         return;
     }
 
-    if (secuencias.size() == 1) {
-        cout << "1 secuencia cargada correctamente desde " << nombreArchivo << ".\n";
+    // Se reemplazan secuencias anteriores; quien todavia use la version anterior la conserva
+    size_t cantidad = leidas.size();
+    EdicionSecuencias edicion(false);
+    edicion.version().secuencias.swap(leidas);
+    edicion.version().reconstruir_indice();
+    edicion.publicar();
+
+    if (cantidad == 0) {
+        salida() << nombreArchivo << " no contiene ninguna secuencia.\n";
+        return;
+    }
+
+    if (cantidad == 1) {
+        salida() << "1 secuencia cargada correctamente desde " << nombreArchivo << ".\n";
         return;
     } else {
-        cout << secuencias.size() << " secuencias cargadas correctamente desde " 
+        salida() << cantidad << " secuencias cargadas correctamente desde " 
              << nombreArchivo << ".\n";
         return;
     }
 }
 
+// Carga varios archivos FASTA a la vez (un hilo por archivo) y los agrega a las secuencias en memoria
+void cargar_agregar(const string* archivos, int num_archivos, bool suave) {
+    vector<vector<Secuencia> > leidas(num_archivos);
+    vector<char> correcto(num_archivos, false);
+
+    vector<thread> hilos;
+    for (int f = 1; f < num_archivos; f++) {
+        hilos.push_back(thread([&leidas, &correcto, archivos, f, suave]() {
+            correcto[f] = leer_fasta(archivos[f], leidas[f], suave);
+        }));
+    }
+    correcto[0] = leer_fasta(archivos[0], leidas[0], suave);
+    for (size_t t = 0; t < hilos.size(); t++) {
+        hilos[t].join();
+    }
+
+    // Agregar en el orden en que se dieron los archivos, todos en la misma version nueva
+    EdicionSecuencias edicion;
+    for (int f = 0; f < num_archivos; f++) {
+        if (!correcto[f]) {
+            salida() << archivos[f] << " no se encuentra o no puede leerse.\n";
+            continue;
+        }
+        size_t cantidad = leidas[f].size();
+        int omitidas = edicion.version().agregar(leidas[f]);
+        if (cantidad == 0) {
+            salida() << archivos[f] << " no contiene ninguna secuencia.\n";
+            continue;
+        }
+        salida() << cantidad - omitidas << " secuencias agregadas desde " << archivos[f] << ".\n";
+        if (omitidas > 0) {
+            salida() << omitidas << " secuencias de " << archivos[f]
+                 << " se omitieron porque su descripcion ya existe en memoria.\n";
+        }
+    }
+    edicion.publicar();
+}
+
 void listar_secuencias() {
+    Instantanea version = instantanea();
+    const vector<Secuencia>& secuencias = version->secuencias;
     if (secuencias.empty()) {
-        cout << "No hay secuencias cargadas en memoria.\n";
+        salida() << "No hay secuencias cargadas en memoria.\n";
         return;
     }
-    cout << "Hay " << secuencias.size() << " secuencias cargadas en memoria:\n";
+    salida() << "Hay " << secuencias.size() << " secuencias cargadas en memoria:\n";
 
     // Recorremos cada secuencia por índice
     for (int i = 0; i < secuencias.size(); i++) {
         int guiones = 0;
         int bases_minimas = 0;
+        Bases bases = bases_de(secuencias[i]);
 
         // Contar guiones y bases mínimas en la secuencia actual
-        for (int j = 0; j < secuencias[i].bases.size(); j++) {
-            char base = secuencias[i].bases[j];
+        for (int j = 0; j < bases->texto.size(); j++) {
+            char base = bases->texto[j];
             if (base == '-') {
                 guiones++;
             } else {
@@ -183,44 +423,41 @@ void listar_secuencias() {
 
         if (guiones == 0) {
             // Secuencia completa (sin guiones)
-            cout << "Secuencia " << secuencias[i].descripcion
+            salida() << "Secuencia " << secuencias[i].descripcion
                  << " contiene " << bases_minimas << " bases.\n";
         } else {
             // Secuencia incompleta (con guiones)
-            cout << "Secuencia " << secuencias[i].descripcion
+            salida() << "Secuencia " << secuencias[i].descripcion
                  << " contiene al menos " << bases_minimas << " bases.\n";
         }
     }
 }
 
-void histograma(string descripcion) {
-    if (secuencias.empty()) {
-        cout << "Secuencia inválida.\n";
+void histograma(const string& descripcion) {
+    Instantanea version = instantanea();
+    if (version->secuencias.empty()) {
+        salida() << "Secuencia inválida.\n";
         return;
     }
 
     // Buscar la secuencia en memoria
-    int indice = -1;
-    for (int i = 0; i < secuencias.size(); i++) {
-        if (secuencias[i].descripcion == descripcion) {
-            indice = i;
-            break;
-        }
-    }
+    int indice = version->buscar(descripcion);
 
     if (indice == -1) {
-        cout << "Secuencia inválida.\n";
+        salida() << "Secuencia inválida.\n";
         return;
     }
+    Bases bases = bases_de(version->secuencias[indice]);
 
     // Símbolos en el orden de la tabla
-    string simbolos = "ACGTURYKMSWBDHVNX-";
-    int frecuencia[18] = {0};
+    const char simbolos[] = "ACGTURYKMSWBDHVNX-";
+    const int num_simbolos = sizeof(simbolos) - 1;
+    int frecuencia[num_simbolos] = {0};
 
     // Contar frecuencias
-    for (int j = 0; j < secuencias[indice].bases.size(); j++) {
-        char base = secuencias[indice].bases[j];
-        for (int k = 0; k < simbolos.size(); k++) {
+    for (int j = 0; j < bases->texto.size(); j++) {
+        char base = bases->texto[j];
+        for (int k = 0; k < num_simbolos; k++) {
             if (base == simbolos[k]) {
                 frecuencia[k]++;
                 break;
@@ -229,115 +466,335 @@ void histograma(string descripcion) {
     }
 
     // Imprimir resultados
-    for (int k = 0; k < simbolos.size(); k++) {
-        cout << simbolos[k] << " : " << frecuencia[k] << "\n";
+    for (int k = 0; k < num_simbolos; k++) {
+        salida() << simbolos[k] << " : " << frecuencia[k] << "\n";
     }
 }
 
-void subsecuencia(string sub) {
+// Devuelve el complemento IUPAC de un código (R<->Y, K<->M, B<->V, D<->H; S, W, N, X y '-' son su propio complemento)
+char complemento_iupac(char codigo) {
+    return TABLA_COMPLEMENTO[(unsigned char)codigo];
+}
+
+// Construye el complemento inverso de una subsecuencia (lectura de la otra hebra)
+string complemento_inverso(const string& sub) {
+    string resultado;
+    complemento_inverso(sub, resultado);
+    return resultado;
+}
+
+// Igual, sobre un destino existente que conserva su memoria
+void complemento_inverso(const string& sub, string& destino) {
+    destino.resize(sub.size());
+    for (size_t k = 0; k < sub.size(); k++) {
+        destino[k] = complemento_iupac(sub[sub.size() - 1 - k]);
+    }
+}
+
+// Verifica si el patron coincide con el texto a partir de la posicion dada, usando compatibilidad biológica
+bool coincide_en(const string& texto, size_t pos, const string& patron) {
+    for (size_t k = 0; k < patron.size(); k++) {
+        if (!iupac_compatibles(texto[pos + k], patron[k])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void subsecuencia(const string& sub, bool ambas_hebras) {
+    Instantanea version = instantanea();
+    const vector<Secuencia>& secuencias = version->secuencias;
     if (secuencias.empty()) {
-        cout << "No hay secuencias cargadas en memoria.\n";
+        salida() << "No hay secuencias cargadas en memoria.\n";
         return;
     }
 
-    int total = 0;
+    int total = 0;         // Coincidencias en la hebra directa
+    int total_inversa = 0; // Coincidencias en la hebra complementaria inversa
+
+    // El patron de la otra hebra se calcula una sola vez y se prueba en el mismo recorrido
+    string& inversa = memoria_sesion().patron_inverso;
+    if (ambas_hebras) complemento_inverso(sub, inversa);
+    else inversa.clear();
 
     // Recorremos todas las secuencias cargadas
     for (int i = 0; i < secuencias.size(); i++) {
-        string texto = secuencias[i].bases;
-
-        // Buscar la subsecuencia usando compatibilidad biológica
-        for (int j = 0; j <= (texto.size() - sub.size()); j++) {
-            bool coincide = true;
-
-            // Comparar carácter por carácter usando compatibilidad
-            for (int k = 0; k < sub.size(); k++) {
-                if (!son_compatibles(texto[j + k], sub[k])) {
-                    coincide = false;
-                    break;
+        Bases bases = bases_de(secuencias[i]);
+        const string& texto = bases->texto;
+        if (!sub.empty() && texto.size() >= sub.size()) {
+            // Buscar la subsecuencia usando compatibilidad biológica, con el recorrido que permita el alfabeto.
+            // Las dos hebras se recorren juntas: siempre avanza el cursor que quedo mas atras, asi que
+            // el texto se lee una sola vez aunque se busquen los dos patrones
+            Buscador directo(sub, bases->alfabeto), complementario(inversa, bases->alfabeto);
+            size_t j_directa = directo.siguiente(texto, 0);
+            size_t j_inversa = ambas_hebras ? complementario.siguiente(texto, 0) : string::npos;
+            while (j_directa != string::npos || j_inversa != string::npos) {
+                if (j_directa <= j_inversa) {
+                    total++;
+                    j_directa = directo.siguiente(texto, j_directa + 1);
+                } else {
+                    total_inversa++;
+                    j_inversa = complementario.siguiente(texto, j_inversa + 1);
                 }
             }
+        }
+    }
 
-            if (coincide) {
-                total++;
-            }
+    if (ambas_hebras) {
+        if (total == 0 && total_inversa == 0) {
+            salida() << "La subsecuencia dada no existe en ninguna de las dos hebras de las secuencias cargadas en memoria.\n";
+        } else {
+            salida() << "La subsecuencia dada se repite " << total << " veces en la hebra directa y "
+                 << total_inversa << " veces en la hebra complementaria inversa dentro de las secuencias cargadas en memoria.\n";
         }
+        return;
     }
 
     if (total == 0) {
-        cout << "La subsecuencia dada no existe dentro de las secuencias cargadas en memoria.\n";
+        salida() << "La subsecuencia dada no existe dentro de las secuencias cargadas en memoria.\n";
     } else {
-        cout << "La subsecuencia dada se repite " << total
+        salida() << "La subsecuencia dada se repite " << total
              << " veces dentro de las secuencias cargadas en memoria.\n";
     }
 }
 
-void enmascarar(string sub) {
+// Escribe una ubicacion en formato TSV: descripcion, desplazamiento, fila, columna y hebra
+static void escribir_ubicacion(EscritorBuffer& escritor, const Secuencia& sec, size_t pos, char hebra) {
+    escritor.escribir(sec.descripcion);
+    escritor.escribir('\t');
+    escritor.escribir_numero(pos);
+    escritor.escribir('\t');
+    escritor.escribir_numero(pos / sec.ancho_linea); // Fila en la matriz de ancho_linea columnas
+    escritor.escribir('\t');
+    escritor.escribir_numero(pos % sec.ancho_linea); // Columna
+    escritor.escribir('\t');
+    escritor.escribir(hebra);
+    escritor.escribir('\n');
+}
+
+void ubicar_subsecuencia(const string& sub, const string& nombreArchivo) {
+    Instantanea version = instantanea();
+    const vector<Secuencia>& secuencias = version->secuencias;
     if (secuencias.empty()) {
-        cout << "No hay secuencias cargadas en memoria.\n";
+        salida() << "No hay secuencias cargadas en memoria.\n";
         return;
     }
 
-    int total = 0;
+    // Sin archivo se escribe en la consola; en ambos casos la memoria usada no depende del numero de coincidencias
+    ofstream archivo;
+    if (!nombreArchivo.empty()) {
+        archivo.open(nombreArchivo);
+        if (!archivo.is_open()) {
+            salida() << "Error guardando en " << nombreArchivo << ".\n";
+            return;
+        }
+    }
+    ostream& destino = nombreArchivo.empty() ? salida() : archivo;
+
+    uint64_t total = 0;
+    string& inversa = memoria_sesion().patron_inverso;
+    complemento_inverso(sub, inversa);
+    {
+        EscritorBuffer escritor(destino);
+        escritor.escribir("descripcion\tdesplazamiento\tfila\tcolumna\thebra\n");
+
+        for (int i = 0; i < secuencias.size(); i++) {
+            const Secuencia& sec = secuencias[i];
+            Bases bases = bases_de(sec);
+            const string& texto = bases->texto;
+            if (!sub.empty() && texto.size() >= sub.size()) {
+                Buscador directo(sub, bases->alfabeto), complementario(inversa, bases->alfabeto);
+
+                // Se mezclan las dos hebras en orden de posicion; en la misma posicion va primero '+'
+                size_t j_directa = directo.siguiente(texto, 0);
+                size_t j_inversa = complementario.siguiente(texto, 0);
+                while (j_directa != string::npos || j_inversa != string::npos) {
+                    if (j_directa <= j_inversa) {
+                        escribir_ubicacion(escritor, sec, j_directa, '+');
+                        j_directa = directo.siguiente(texto, j_directa + 1);
+                    } else {
+                        escribir_ubicacion(escritor, sec, j_inversa, '-');
+                        j_inversa = complementario.siguiente(texto, j_inversa + 1);
+                    }
+                    total++;
+                }
+            }
+        }
+    } // El escritor vacia su buffer al salir de este bloque
 
-    // Recorremos todas las secuencias cargadas
-    for (int i = 0; i < secuencias.size(); i++) {
-        string& texto = secuencias[i].bases; // Referencia para modificar directamente
+    if (!destino.good()) {
+        salida() << "Error guardando en " << nombreArchivo << ".\n";
+        return;
+    }
 
-        // Buscar y enmascarar todas las ocurrencias usando compatibilidad biológica
-        for (int j = 0; j <= (texto.size() - sub.size()); j++) {
-            bool coincide = true;
+    if (total == 0) {
+        salida() << "La subsecuencia dada no existe dentro de las secuencias cargadas en memoria.\n";
+    } else if (!nombreArchivo.empty()) {
+        salida() << total << " ubicaciones de la subsecuencia han sido escritas en " << nombreArchivo << ".\n";
+    }
+}
 
-            // Comparar carácter por carácter usando compatibilidad
-            for (int k = 0; k < sub.size(); k++) {
-                if (!son_compatibles(texto[j + k], sub[k])) {
-                    coincide = false;
-                    break;
-                }
-            }
+void enmascarar(string sub, bool ambas_hebras, bool suave) {
+    // Se enmascara sobre una version nueva; quien lea mientras tanto sigue viendo la anterior completa
+    EdicionSecuencias edicion;
+    vector<Secuencia>& secuencias = edicion.version().secuencias;
+    if (secuencias.empty()) {
+        salida() << "No hay secuencias cargadas en memoria.\n";
+        return;
+    }
+
+    int total = 0;         // Enmascaramientos por la hebra directa
+    int total_inversa = 0; // Enmascaramientos por la hebra complementaria inversa
+
+    string inversa = ambas_hebras ? complemento_inverso(sub) : "";
 
-            if (coincide) {
-                // Enmascarar reemplazando cada carácter por 'X'
-                for (int k = 0; k < sub.size(); k++) {
-                    texto[j + k] = 'X';
+    // Recorremos todas las secuencias cargadas
+    for (int i = 0; i < secuencias.size(); i++) {
+        Bases bases = bases_de(secuencias[i]);
+        const string& texto = bases->texto; // Las bases publicadas no se tocan
+        if (sub.empty() || texto.size() < sub.size()) continue;
+
+        // Buscar y enmascarar todas las ocurrencias usando compatibilidad biológica.
+        // Cada busqueda sigue despues de la ultima mascara, asi que basta buscar en el texto original
+        // y aplicar las mascaras sobre una copia, que se crea con la primera coincidencia
+        Buscador directo(sub, bases->alfabeto);
+        Buscador complementario(inversa, bases->alfabeto);
+        uint64_t encontradas = 0;
+        string copia;
+        MascaraSuave nuevos; // Tramos a pasar a minuscula, en orden
+
+        // Siguiente coincidencia de cada hebra; una posicion ya conocida sigue siendo valida
+        // mientras quede despues de la ultima mascara
+        size_t j_directa = directo.siguiente(texto, 0);
+        size_t j_inversa = ambas_hebras ? complementario.siguiente(texto, 0) : string::npos;
+        while (j_directa != string::npos || j_inversa != string::npos) {
+            size_t j = min(j_directa, j_inversa);
+            bool directa = j_directa == j;
+            bool complementaria = j_inversa == j;
+
+            // Enmascarar reemplazando cada carácter por 'X', o en suave pasando el tramo a minuscula
+            if (suave) {
+                extender_mascara(nuevos, j, j + sub.size());
+            } else {
+                if (copia.empty()) copia = texto;
+                for (size_t k = 0; k < sub.size(); k++) {
+                    copia[j + k] = 'X';
                 }
-                total++;
-                j += sub.size() - 1; // Saltar los caracteres enmascarados
             }
+            if (directa) total++;
+            if (complementaria) total_inversa++;
+            encontradas += (directa ? 1 : 0) + (complementaria ? 1 : 0);
+
+            // Saltar los caracteres enmascarados
+            j += sub.size();
+            if (j_directa < j) j_directa = directo.siguiente(texto, j);
+            if (j_inversa < j) j_inversa = ambas_hebras ? complementario.siguiente(texto, j) : string::npos;
+        }
+        // La secuencia modificada deja de depender del FASTA indexado. Las bases nuevas conservan
+        // la mascara suave que ya tenian; en suave el texto no cambia y se comparte con las bases anteriores
+        if (encontradas > 0) {
+            MascaraSuave mascara = suave ? unir_mascaras(bases->suave, nuevos) : bases->suave;
+            secuencias[i].bases = suave ? cambiar_mascara(bases, mascara) : crear_bases(copia, mascara);
+            secuencias[i].origen.reset();
+        }
+    }
+    if (total + total_inversa > 0) {
+        edicion.publicar();
+    }
+
+    string modo = suave ? " en minuscula" : "";
+    if (ambas_hebras) {
+        if (total == 0 && total_inversa == 0) {
+            salida() << "La subsecuencia dada no existe en ninguna de las dos hebras de las secuencias cargadas en memoria, por tanto no se enmascara nada.\n";
+        } else {
+            salida() << total << " subsecuencias de la hebra directa y " << total_inversa
+                 << " de la hebra complementaria inversa han sido enmascaradas" << modo << " dentro de las secuencias cargadas en memoria.\n";
         }
+        return;
     }
 
     if (total == 0) {
-        cout << "La subsecuencia dada no existe dentro de las secuencias cargadas en memoria, por tanto no se enmascara nada.\n";
+        salida() << "La subsecuencia dada no existe dentro de las secuencias cargadas en memoria, por tanto no se enmascara nada.\n";
     } else {
-        cout << total << " subsecuencias han sido enmascaradas dentro de las secuencias cargadas en memoria.\n";
+        salida() << total << " subsecuencias han sido enmascaradas" << modo << " dentro de las secuencias cargadas en memoria.\n";
+    }
+}
+
+// Verifica si un nombre de archivo termina con la extension dada
+bool termina_con(const string& texto, const string& sufijo) {
+    return texto.size() >= sufijo.size() &&
+           texto.compare(texto.size() - sufijo.size(), sufijo.size(), sufijo) == 0;
+}
+
+// Escribe todas las secuencias en formato FASTA sobre el destino (EscritorBinario o EscritorBgzf).
+// Cada linea se copia directamente desde el string almacenado, sin copias intermedias de las bases;
+// solo las lineas que tocan un tramo de la mascara suave pasan por una copia para escribirlo en minuscula
+template<typename Destino>
+void escribir_fasta(Destino& destino, const vector<Secuencia>& secuencias) {
+    string linea;
+    for (size_t i = 0; i < secuencias.size(); i++) {
+        const Secuencia& sec = secuencias[i];
+        Bases bases_sec = bases_de(sec);
+        destino.escribir_u8('>');
+        destino.escribir_bytes(sec.descripcion.data(), sec.descripcion.size());
+        destino.escribir_u8('\n');
+
+        // Escribir las bases en lineas del mismo tamaño (ancho original)
+        const char* bases = bases_sec->texto.data();
+        size_t total = bases_sec->texto.size();
+        size_t ancho = sec.ancho_linea;
+        const MascaraSuave& suave = bases_sec->suave;
+        size_t m = 0; // Primer tramo que no termina antes de la linea en curso
+        for (size_t j = 0; j < total; j += ancho) {
+            size_t n = min(ancho, total - j);
+            while (m < suave.size() && suave[m].fin <= j) m++;
+            if (m == suave.size() || suave[m].inicio >= j + n) {
+                destino.escribir_bytes(bases + j, n);
+            } else {
+                linea.assign(bases + j, n);
+                for (size_t t = m; t < suave.size() && suave[t].inicio < j + n; t++) {
+                    for (size_t k = max<uint64_t>(suave[t].inicio, j); k < min<uint64_t>(suave[t].fin, j + n); k++) {
+                        linea[k - j] = tolower((unsigned char)linea[k - j]);
+                    }
+                }
+                destino.escribir_bytes(linea.data(), n);
+            }
+            destino.escribir_u8('\n');
+        }
     }
 }
 
 void guardar_archivo(string nombreArchivo) {
-    if (secuencias.empty()) {
-        cout << "No hay secuencias cargadas en memoria.\n";
+    Instantanea version = instantanea();
+    if (version->secuencias.empty()) {
+        salida() << "No hay secuencias cargadas en memoria.\n";
         return;
     }
 
-    ofstream archivo(nombreArchivo);
-    if (!archivo.is_open()) {
-        cout << "Error guardando en " << nombreArchivo << ".\n";
+    // Se escribe a un archivo temporal y se renombra al final, de modo que el archivo
+    // destino nunca queda a medio escribir si algo falla
+    string temporal = nombreArchivo + ".tmp";
+    EscritorBinario archivo;
+    if (!archivo.abrir(temporal)) {
+        salida() << "Error guardando en " << nombreArchivo << ".\n";
         return;
     }
 
-    for (int i = 0; i < secuencias.size(); i++) {
-        archivo << ">" << secuencias[i].descripcion << "\n";
-        // Escribir las bases en lineas del mismo tamaño
-        string bases = secuencias[i].bases;
-        int anchoPorLinea = secuencias[i].ancho_linea; // Usar ancho original
-        
-        for (int j = 0; j < bases.size(); j += anchoPorLinea) {
-            string linea = bases.substr(j, anchoPorLinea);
-            archivo << linea << "\n";
-        }
+    // Las extensiones .gz y .bgz se guardan comprimidas en BGZF (compatible con gzip)
+    bool correcto;
+    if (termina_con(nombreArchivo, ".gz") || termina_con(nombreArchivo, ".bgz")) {
+        EscritorBgzf comprimido(archivo);
+        escribir_fasta(comprimido, version->secuencias);
+        correcto = comprimido.terminar();
+    } else {
+        escribir_fasta(archivo, version->secuencias);
+        correcto = true;
     }
 
-    archivo.close();
-    cout << "Las secuencias han sido guardadas en " << nombreArchivo << ".\n";
+    if (!archivo.cerrar() || !correcto || rename(temporal.c_str(), nombreArchivo.c_str()) != 0) {
+        remove(temporal.c_str());
+        salida() << "Error guardando en " << nombreArchivo << ".\n";
+        return;
+    }
+    salida() << "Las secuencias han sido guardadas en " << nombreArchivo << ".\n";
 }
@@ -6,30 +6,131 @@
 #include <vector>
 #include <fstream>
 #include <sstream>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
 
 using namespace std;
 
+// Entrada de un indice .fai (formato de samtools faidx)
+struct EntradaFai {
+    uint64_t longitud;        // Numero de bases de la secuencia
+    uint64_t desplazamiento;  // Byte del archivo donde empieza la primera linea de bases
+    uint32_t bases_linea;     // Bases por linea
+    uint32_t bytes_linea;     // Bytes por linea, incluyendo el salto de linea
+};
+
+// Tramo [inicio, fin) de bases en minuscula en el archivo original (enmascaramiento suave)
+struct IntervaloSuave {
+    uint64_t inicio;
+    uint64_t fin;
+};
+typedef vector<IntervaloSuave> MascaraSuave; // Ordenados por inicio, sin solaparse ni tocarse
+
+inline bool operator==(const IntervaloSuave& a, const IntervaloSuave& b) {
+    return a.inicio == b.inicio && a.fin == b.fin;
+}
+
+// Agrega el tramo [inicio, fin) al final de la mascara, uniendolo con el ultimo si se solapan o se tocan.
+// 'inicio' no puede ser menor que el inicio del ultimo tramo
+void extender_mascara(MascaraSuave& mascara, uint64_t inicio, uint64_t fin);
+MascaraSuave unir_mascaras(const MascaraSuave& a, const MascaraSuave& b);
+
+// Bases de una secuencia. No cambian una vez creadas: varias versiones del conjunto comparten
+// las mismas bases y un comando que las modifica crea una copia nueva (copia en escritura).
+// El texto siempre esta en mayuscula, asi que las busquedas y la codificacion no ven la mascara suave.
+// El texto se guarda aparte para que las bases que solo cambian la mascara suave lo compartan
+struct BasesSecuencia {
+    shared_ptr<const string> datos; // Dueño del texto
+    const string& texto;            // *datos
+    uint8_t alfabeto;               // Clases de simbolos presentes (CLASE_* de iupac.h)
+    MascaraSuave suave;             // Tramos en minuscula (vacio si no se conservaron al cargar)
+
+    BasesSecuencia() : datos(make_shared<string>()), texto(*datos), alfabeto(0) {}
+    BasesSecuencia(shared_ptr<const string> datos, uint8_t alfabeto) : datos(datos), texto(*datos), alfabeto(alfabeto) {}
+    BasesSecuencia(const BasesSecuencia&) = delete;
+    BasesSecuencia& operator=(const BasesSecuencia&) = delete;
+};
+typedef shared_ptr<const BasesSecuencia> Bases;
+
+Bases crear_bases(string& texto); // Toma el contenido de 'texto' y calcula su alfabeto
+Bases crear_bases(string& texto, MascaraSuave& suave); // Toma tambien el contenido de 'suave'
+Bases cambiar_mascara(const Bases& bases, MascaraSuave& suave); // Mismo texto (compartido) con la mascara 'suave'
+
+class FastaIndexado; // Archivo proyectado de cargar_indexado (indexado.cpp)
+
 // Estructura para representar una secuencia genética
 struct Secuencia {
     string descripcion; // Nombre de la secuencia que viene después de '>'
-    string bases;       // Secuencia de letras A, C, G, T, etc (nucleotidos).
+    Bases bases;        // Secuencia de letras A, C, G, T, etc (nucleotidos). Vacio si es diferida
     int ancho_linea;    // Ancho de línea original del archivo FASTA 
+
+    // Carga diferida (cargar_indexado): las bases se copian del archivo solo cuando un comando las usa
+    shared_ptr<FastaIndexado> origen; // Nulo para las secuencias cargadas de forma normal
+    EntradaFai fai;
+};
+
+// Bases de la secuencia, materializandolas desde el FASTA indexado si hace falta.
+// Mientras el llamador conserve el puntero las bases no se descartan
+Bases bases_de(const Secuencia& sec);
+
+// Una version del conjunto de secuencias en memoria. Una vez publicada no se modifica: los comandos
+// que solo leen toman una instantanea y trabajan sobre ella sin esperar a nadie, y los que modifican
+// arman una version nueva y la publican de una vez (el esquema de RCU)
+struct VersionSecuencias {
+    uint64_t numero;
+    vector<Secuencia> secuencias;
+    unordered_map<string, int> indice_nombres; // descripcion -> posicion de su primera aparicion
+
+    int buscar(const string& descripcion) const; // Posicion de la secuencia o -1
+    void reconstruir_indice();                   // Despues de reemplazar todas las secuencias
+    int agregar(vector<Secuencia>& nuevas);      // Omite las descripciones repetidas; devuelve cuantas
 };
+typedef shared_ptr<const VersionSecuencias> Instantanea;
 
-// Declaración extern para la variable global
-extern vector<Secuencia> secuencias;
+// Version vigente; el puntero devuelto la mantiene viva aunque otro comando publique una nueva
+Instantanea instantanea();
+
+// Edicion del conjunto: toma el candado de escritura (las ediciones se ordenan entre si, las lecturas
+// no lo usan) y parte de una copia de la version vigente, o de una version vacia si se va a reemplazar todo.
+// La copia solo duplica los descriptores; las bases se comparten hasta que se modifiquen
+class EdicionSecuencias {
+public:
+    explicit EdicionSecuencias(bool copiar_vigente = true);
+    VersionSecuencias& version() { return *nueva; }
+    void publicar(); // Sin publicar, los cambios se descartan al destruir la edicion
+
+private:
+    unique_lock<mutex> candado;
+    shared_ptr<VersionSecuencias> nueva;
+};
 
 // Declaraciones de funciones para el manejo de secuencias genéticas
-void cargar_archivo(string nombreArchivo);
+// Con 'suave', las bases en minuscula se recuerdan como tramos de la mascara suave
+void cargar_archivo(string nombreArchivo, bool suave = false);
+void cargar_agregar(const string* archivos, int num_archivos, bool suave = false);
 void listar_secuencias();
-void histograma(string descripcion);
-void subsecuencia(string sub);
-void enmascarar(string sub);
+// Las consultas reciben los argumentos por referencia, tal como quedan en las partes de la linea de comando
+void histograma(const string& descripcion);
+void subsecuencia(const string& sub, bool ambas_hebras = false);
+void enmascarar(string sub, bool ambas_hebras = false, bool suave = false);
+void ubicar_subsecuencia(const string& sub, const string& nombreArchivo = "");
 void guardar_archivo(string nombreArchivo);
 
+// Carga diferida desde un FASTA indexado (.fai)
+void cargar_indexado(string nombreArchivo, string memoria_mb = "", bool suave = false);
+
 // Funciones auxiliares para manejar códigos ambiguos
 bool es_base_valida(char base);
 int obtener_bases_minimas(char codigo);
 bool son_compatibles(char codigo_secuencia, char codigo_busqueda);
 
+// Funciones auxiliares para la busqueda en ambas hebras
+char complemento_iupac(char codigo);
+string complemento_inverso(const string& sub);
+void complemento_inverso(const string& sub, string& destino);
+bool coincide_en(const string& texto, size_t pos, const string& patron);
+bool termina_con(const string& texto, const string& sufijo);
+
 #endif 
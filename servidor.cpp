@@ -0,0 +1,193 @@
+#include "servidor.h"
+#include "comandos.h"
+#include "interfaz.h"
+#include "protocolo.h"
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <deque>
+#include <set>
+#include <vector>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace std;
+
+const int MAX_HILOS_SERVIDOR = 256;
+
+// Estado compartido entre el hilo que acepta conexiones y el grupo de hilos que las atiende
+struct EstadoServidor {
+    int socket_escucha;
+    atomic<bool> detenido;
+
+    mutex candado;
+    condition_variable hay_conexiones;
+    deque<int> pendientes; // Conexiones aceptadas que ningun hilo atiende todavia
+    set<int> activas;      // Conexiones en atencion, para despertarlas al detener
+    bool cerrado;          // Ya no se aceptan conexiones
+
+    EstadoServidor() : socket_escucha(-1), detenido(false), cerrado(false) {}
+};
+
+// Deja de aceptar conexiones; el hilo que espera en accept() se despierta con un error
+static void detener(EstadoServidor& estado) {
+    if (!estado.detenido.exchange(true)) {
+        shutdown(estado.socket_escucha, SHUT_RDWR);
+    }
+}
+
+// Ejecuta una consulta capturando todo lo que escribe el comando
+static string responder(const string& linea, bool& seguir) {
+    ostringstream respuesta;
+    RedireccionSalida redireccion(respuesta);
+    try {
+        seguir = ejecutar_comando(linea);
+    } catch (const exception& e) {
+        respuesta << "Error: " << e.what() << "\n"; // Un comando fallido no debe tumbar al servidor
+        seguir = true;
+    }
+    return respuesta.str();
+}
+
+// Atiende las consultas de un cliente hasta que cierra la conexion o envia 'salir'
+static void atender_cliente(EstadoServidor& estado, int cliente) {
+    string linea;
+    while (recibir_mensaje(cliente, linea, MAX_PETICION)) {
+        string partes[MAX_PARTES];
+        int num_partes = dividir(linea, partes);
+        string comando = num_partes > 0 ? partes[0] : "";
+
+        if (comando == "detener") {
+            enviar_mensaje(cliente, "Servidor detenido.\n");
+            detener(estado);
+            return;
+        }
+        if (comando == "servidor") {
+            enviar_mensaje(cliente, "Error: El servidor ya esta en ejecucion.\n");
+            continue;
+        }
+
+        bool seguir = true;
+        if (!enviar_mensaje(cliente, responder(linea, seguir)) || !seguir) {
+            return;
+        }
+    }
+}
+
+static void hilo_trabajador(EstadoServidor& estado) {
+    while (true) {
+        int cliente;
+        {
+            unique_lock<mutex> bloqueo(estado.candado);
+            estado.hay_conexiones.wait(bloqueo, [&estado]() { return estado.cerrado || !estado.pendientes.empty(); });
+            if (estado.pendientes.empty()) return; // Cerrado y sin nada por atender
+            cliente = estado.pendientes.front();
+            estado.pendientes.pop_front();
+            if (estado.cerrado) {
+                close(cliente);
+                continue;
+            }
+            estado.activas.insert(cliente);
+        }
+
+        atender_cliente(estado, cliente);
+
+        {
+            lock_guard<mutex> bloqueo(estado.candado);
+            estado.activas.erase(cliente);
+        }
+        close(cliente);
+    }
+}
+
+// Crea el socket de escucha; reemplaza un socket que haya quedado de una ejecucion anterior
+static int abrir_socket(const string& ruta) {
+    struct sockaddr_un direccion;
+    memset(&direccion, 0, sizeof(direccion));
+    direccion.sun_family = AF_UNIX;
+    if (ruta.empty() || ruta.size() >= sizeof(direccion.sun_path)) {
+        salida() << "Error: La ruta del socket debe tener entre 1 y " << sizeof(direccion.sun_path) - 1 << " caracteres.\n";
+        return -1;
+    }
+    memcpy(direccion.sun_path, ruta.c_str(), ruta.size());
+
+    struct stat info;
+    if (lstat(ruta.c_str(), &info) == 0) {
+        if (!S_ISSOCK(info.st_mode)) {
+            salida() << "Error: " << ruta << " ya existe y no es un socket.\n";
+            return -1;
+        }
+        unlink(ruta.c_str());
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || bind(fd, (struct sockaddr*)&direccion, sizeof(direccion)) != 0 || listen(fd, 64) != 0) {
+        if (fd >= 0) close(fd);
+        salida() << "Error: No se puede escuchar en " << ruta << ".\n";
+        return -1;
+    }
+    return fd;
+}
+
+void servidor(string ruta_socket, string hilos_str) {
+    int num_hilos = thread::hardware_concurrency();
+    if (num_hilos < 1) num_hilos = 1;
+    if (!hilos_str.empty()) {
+        try {
+            num_hilos = stoi(hilos_str);
+        } catch (...) {
+            num_hilos = 0;
+        }
+        if (num_hilos < 1 || num_hilos > MAX_HILOS_SERVIDOR) {
+            salida() << "Error: La cantidad de hilos debe estar entre 1 y " << MAX_HILOS_SERVIDOR << ".\n";
+            return;
+        }
+    }
+
+    EstadoServidor estado;
+    estado.socket_escucha = abrir_socket(ruta_socket);
+    if (estado.socket_escucha < 0) return;
+
+    vector<thread> hilos;
+    for (int t = 0; t < num_hilos; t++) {
+        hilos.push_back(thread(hilo_trabajador, ref(estado)));
+    }
+    salida() << "Servidor escuchando en " << ruta_socket << " con " << num_hilos
+             << " hilos. Un cliente puede enviar 'detener' para terminarlo.\n";
+    salida().flush();
+
+    // Aceptar conexiones y repartirlas al grupo de hilos
+    while (!estado.detenido) {
+        int cliente = accept(estado.socket_escucha, nullptr, nullptr);
+        if (cliente < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            break; // Socket cerrado por 'detener'
+        }
+        lock_guard<mutex> bloqueo(estado.candado);
+        estado.pendientes.push_back(cliente);
+        estado.hay_conexiones.notify_one();
+    }
+
+    // Despertar a los hilos que esperan una consulta de sus clientes y esperar a que terminen
+    {
+        lock_guard<mutex> bloqueo(estado.candado);
+        estado.cerrado = true;
+        for (set<int>::iterator it = estado.activas.begin(); it != estado.activas.end(); ++it) {
+            shutdown(*it, SHUT_RDWR);
+        }
+        estado.hay_conexiones.notify_all();
+    }
+    for (size_t t = 0; t < hilos.size(); t++) {
+        hilos[t].join();
+    }
+    close(estado.socket_escucha);
+    unlink(ruta_socket.c_str());
+
+    salida() << "Servidor detenido.\n";
+}
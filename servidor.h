@@ -0,0 +1,13 @@
+#ifndef SERVIDOR_H
+#define SERVIDOR_H
+
+#include <string>
+
+using namespace std;
+
+// Comando: servidor <socket> [hilos]
+// Atiende los comandos de la consola por un socket UNIX hasta que un cliente envia 'detener'.
+// Las secuencias cargadas quedan en memoria entre consultas y cada hilo del grupo atiende un cliente
+void servidor(string ruta_socket, string hilos_str = "");
+
+#endif
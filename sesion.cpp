@@ -0,0 +1,36 @@
+#include "sesion.h"
+
+using namespace std;
+
+static thread_local MemoriaSesion memoria_hilo;
+
+size_t MemoriaSesion::bytes_reservados() const {
+    size_t bytes = buffer_salida.capacity() + patron_inverso.capacity() + grafo.datos.capacity() +
+                   busqueda.bytes_reservados() + ruta.camino.capacity() * sizeof(Posicion) + ruta.bases.capacity() +
+                   bgzf.bytes_reservados();
+    for (int i = 0; i < MAX_PARTES; i++) {
+        bytes += partes[i].capacity();
+    }
+    return bytes;
+}
+
+MemoriaSesion& memoria_sesion() {
+    return memoria_hilo;
+}
+
+const GrafoSecuencia& grafo_sesion(const Bases& bases, int ancho_linea) {
+    MemoriaSesion& memoria = memoria_hilo;
+    // Las bases son inmutables: si el puntero sigue vivo y es el mismo, el grafo tambien
+    if (memoria.bases_grafo.lock() != bases || memoria.ancho_grafo != ancho_linea) {
+        construir_grafo(bases->texto, ancho_linea, memoria.grafo);
+        memoria.bases_grafo = bases;
+        memoria.ancho_grafo = ancho_linea;
+    }
+    return memoria.grafo;
+}
+
+void terminar_comando_sesion() {
+    if (memoria_hilo.bytes_reservados() > LIMITE_MEMORIA_SESION) {
+        memoria_hilo = MemoriaSesion(); // Un comando excepcional no deja su memoria retenida para siempre
+    }
+}
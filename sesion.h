@@ -0,0 +1,53 @@
+#ifndef SESION_H
+#define SESION_H
+
+#include "interfaz.h"
+#include "secuencias.h"
+#include "grafo.h"
+#include "bgzf.h"
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstddef>
+
+using namespace std;
+
+// Memoria retenida entre comandos mas alla de la cual se devuelve toda al terminar uno
+const size_t LIMITE_MEMORIA_SESION = (size_t)256 << 20;
+
+// Memoria de trabajo de los comandos de un hilo (la consola o cada hilo del servidor).
+// Los comandos de consulta la vacian y la vuelven a llenar en lugar de reservar la suya, asi que
+// una serie de consultas parecidas deja de pedir memoria despues de la primera
+struct MemoriaSesion {
+    string partes[MAX_PARTES];      // Palabras de la linea de comando
+    vector<char> buffer_salida;     // Buffer de las escrituras de texto grandes (ubicar_subsecuencia)
+    string patron_inverso;          // Complemento inverso del patron de la consulta
+    MemoriaBgzf bgzf;               // Tandas de bloques de la descompresion de los FASTA en BGZF
+
+    // Ultimo grafo construido; sirve mientras sean las mismas bases y el mismo ancho de linea
+    GrafoSecuencia grafo;
+    weak_ptr<const BasesSecuencia> bases_grafo;
+    int ancho_grafo;
+    MemoriaBusqueda busqueda;
+    ResultadoRuta ruta;
+
+    MemoriaSesion() : ancho_grafo(0) {}
+    size_t bytes_reservados() const;
+};
+
+// Memoria de la sesion del hilo actual
+MemoriaSesion& memoria_sesion();
+
+// Grafo de las bases en la memoria de la sesion; solo se reconstruye si cambian las bases o el ancho
+const GrafoSecuencia& grafo_sesion(const Bases& bases, int ancho_linea);
+
+// Se llama al terminar cada comando: si la sesion retiene mas de LIMITE_MEMORIA_SESION la devuelve toda
+void terminar_comando_sesion();
+
+// Llama a terminar_comando_sesion al salir del alcance, tambien si el comando termina con una excepcion
+class FinComandoSesion {
+public:
+    ~FinComandoSesion() { terminar_comando_sesion(); }
+};
+
+#endif